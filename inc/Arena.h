@@ -0,0 +1,51 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+using namespace std;
+
+/*
+*	BUMP POINTER ARENA
+*	Table nodes of one assembly job are carved out of large blocks and
+*	released together with the arena. Nodes are never destroyed one by one,
+*	so only trivially destructible types may be created here and teardown
+*	is just freeing the blocks.
+*/
+class Arena
+{
+private:
+	typedef struct Block
+	{
+		Block* next;
+		size_t size;
+	} Block;
+
+	static const size_t BLOCK_SIZE = 64 * 1024;
+
+	Block* blocks;
+	char* current;
+	size_t remaining;
+
+public:
+	Arena();
+	~Arena();
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	void* allocate(size_t size, size_t alignment);
+
+	template <typename T, typename... Args>
+	T* create(Args&&... args)
+	{
+		static_assert(is_trivially_destructible<T>::value, "arena nodes are never destroyed");
+		return new (allocate(sizeof(T), alignof(T))) T(forward<Args>(args)...);
+	}
+};
+
+#endif
@@ -3,9 +3,18 @@
 
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <iomanip>
 #include <sstream>
+#include <vector>
+#include <mutex>
+#include <set>
+#include <cstdint>
 #include "parser.h"
+#include "ObjectFile.h"
+#include "Encoding.h"
+#include "Arena.h"
+#include "StringInterner.h"
 
 using namespace std;
 
@@ -14,17 +23,14 @@ class Assembler
 private:
 	string inputFileName;
 	string outputFileName;
+	bool textOutput;
 
 	unsigned int lineNum;
-	string line;
 
-#define FORMATED_FILE	"temp.s"
 #define UND				0
 #define FIRST			1
 #define SECOND			2
 
-	string int_to_hex = "0123456789ABCDEF";
-
 	/*
 	*	SYMBOL TABLE
 	*/
@@ -45,32 +51,43 @@ private:
 	typedef struct SymbolTableEntry
 	{
 		int id = 0;
-		string name = "";
+		Atom name = 0;
 		unsigned int value = 0;
 		SymbolType type = NOTYPE;
 		int sectionId = 0;
 		SymbolBinding binding = LOCAL;
 	} SymbolTableEntry;
 
-	typedef struct SymbolTable
+	/*
+	*	Open addressing index from symbol name to position in a symbol vector.
+	*	A name keeps the position it was first inserted with.
+	*/
+	typedef struct SymbolIndex
 	{
-		SymbolTableEntry entry;
-		SymbolTable *next;
+		vector<int> slots;
+		unsigned int count = 0;
 
-		SymbolTable(int id, string name, unsigned int value, SymbolType type, int sectionId, SymbolBinding binding);
-	} SymbolTable;
+		int find(Atom name, const vector<SymbolTableEntry>& table) const;
+		void insert(Atom name, int position, const vector<SymbolTableEntry>& table);
+	} SymbolIndex;
 
-	SymbolTable *symtab, *lastEntrySymtab;
-	SymbolTable *symbolList, *lastSymbolList;
+	/*
+	*	Symbol ids are given out densely in insertion order,
+	*	so symtab[id] is always the entry with that id.
+	*/
+	vector<SymbolTableEntry> symtab;
+	SymbolIndex symtabIndex;
+	vector<SymbolTableEntry> symbolList;
+	SymbolIndex symbolListIndex;
 
-	void addNewSectionToSymtab(string name);
-	void addNewSymbolToSymtab(string name);
-	void addExternSymbolsToSymtab(string externSymbolList);
-	bool isInSymbolTable(string name, SymbolTable *table);
-	void deleteSymbolTable();
+	void addSymbolTableEntry(vector<SymbolTableEntry>& table, SymbolIndex& index, int id, Atom name, unsigned int value, SymbolType type, int sectionId, SymbolBinding binding);
+	int findSymbol(Atom name);
+	void addNewSectionToSymtab(Atom name);
+	void addNewSymbolToSymtab(Atom name);
+	void addExternSymbolsToSymtab(const vector<Atom>& externSymbolList);
 	void combineSymbolTable();
-	void changeToGlobal(string symbol);
-	void setSymbolsToGlobal(string symbolList);
+	void changeToGlobal(Atom symbol);
+	void setSymbolsToGlobal(const vector<Atom>& symbolList);
 
 	/*
 	*  SECTION TABLE
@@ -78,7 +95,7 @@ private:
 	typedef struct SectionTableEntry
 	{
 		int id = 0;
-		string name = "";
+		Atom name = 0;
 		unsigned int value = 0;
 	} SectionTableEntry;
 
@@ -87,13 +104,18 @@ private:
 		SectionTableEntry entry;
 		SectionTable *next;
 
-		SectionTable(int id, string name, unsigned int value);
+		SectionTable(int id, Atom name, unsigned int value);
 	} SectionTable;
 
+	/*
+	*	Section and relocation nodes live until the object file is written,
+	*	so they come from one arena per job and are never freed one by one.
+	*/
+	Arena arena;
+
 	SectionTable *sectab, *lastEntrySectab;
 
 	void addSectionsToSectab();
-	void deleteSectionTable();
 
 	/*
 	*  RELOCATION TABLE
@@ -101,9 +123,9 @@ private:
 	typedef struct RelocationTableEntry
 	{
 		unsigned int offset = 0;
-		string type = "";
-		string symbol = "";
-		string section = "";
+		RelocationType type = R_ABS_32;
+		Atom symbol = 0;
+		Atom section = 0;
 		int addend = 0;
 	} RelocationTableEntry;
 
@@ -112,45 +134,109 @@ private:
 		RelocationTableEntry entry;
 		RelocationTable* next;
 
-		RelocationTable(unsigned int offset, string type, string symbol, string section, int addend);
+		RelocationTable(unsigned int offset, RelocationType type, Atom symbol, Atom section, int addend);
 	} RelocationTable;
 
 	RelocationTable* reltab, *lastEntryReltab;
 
-	void addRecordToReltab(string symbol);
-	void deleteRelocationTable();
+	void addRecordToReltab(Atom symbol);
+
+	/*
+	*	Literal pool entries are keyed by the symbol's atom, or by the value
+	*	with LITERAL_CONSTANT set for constants.
+	*/
+	typedef uint64_t LiteralKey;
+
+#define LITERAL_CONSTANT	((LiteralKey)1 << 32)
+
+	/*
+	*	PARSED SOURCE
+	*	Filled once by preprocessing, both passes walk it in order.
+	*	Symbol, label and section names are interned there once, name and
+	*	paramNames carry their atoms so later lookups compare integers.
+	*	mode and literal cache the operand mode and value from the first pass,
+	*	section, offset and length place the statement for section layout.
+	*	MODE_RELATIVE branches jump pc-relative to a label in their own section,
+	*	MODE_POOL operands are read pc-relative from literalOffset.
+	*	literalPool holds the pool written just after the statement.
+	*/
+	typedef struct Statement
+	{
+		unsigned int lineNum = 0;
+		ParsedLine parsed;
+		Atom name = 0;					// operand when it is a symbol
+		vector<Atom> paramNames;		// params that are symbols, 0 for literals
+		OperandMode mode = MODE_REGISTER;
+		unsigned int literal = 0;
+		string section = "";
+		unsigned int offset = 0;
+		unsigned int length = 0;
+		bool noRelax = false;
+		unsigned int literalOffset = 0;
+		vector<LiteralKey> literalPool;
+	} Statement;
+
+	vector<Statement> statements;
+
+	/*
+	*	LITERAL POOLS
+	*	Entries are shared by every reference in range. Pools not flushed at .ltorg or
+	*	after an unconditional jump are written at the end of their section.
+	*/
+	typedef struct LiteralPool
+	{
+		vector<LiteralKey> entries;
+		unordered_map<LiteralKey, unsigned int> index;
+		vector<Statement*> references;
+		unsigned int firstReference = 0;
+	} LiteralPool;
+
+	map<string, vector<LiteralKey>> sectionLiteralPool;
+
+	bool isRelaxationCandidate(Statement& statement);
+	LiteralKey getLiteralKey(Statement& statement);
+	bool isLiteralPoolSpot(Statement& statement);
+	bool literalPoolReaches(LiteralPool& pool, unsigned int end);
+	bool literalPoolFitsUntilNextSpot(size_t i, LiteralPool& pool, unsigned int location);
+	void layoutSections();
+	void placeLiteralPool(LiteralPool& pool, unsigned int offset, unordered_map<LiteralKey, unsigned int>& placed);
+	void writeLiteralPool(vector<LiteralKey>& entries);
+	int getRelativeDisplacement(Atom symbol);
+	int getLiteralPoolDisplacement(Statement& statement);
+	int getOperandDisplacement(Statement& statement);
 
 	/*
 	*	LOCATION COUNTER AND CURRENT SECTION
 	*/
 	string currentSection;
+	Atom currentSectionName;
 	int currentSectionID;
 
 	map<string, unsigned int> sectionLocationCounter;
 
-	map<string, string> sectionData;
+	/*
+	*	Bytes of each section as written by the second pass. Relocated words
+	*	stay zero and are listed as ???????? in the text output.
+	*/
+	map<string, vector<uint8_t>> sectionData;
 
 	map<string, string> sectionRelocationData;
 
 	/*
 	*  HELPER FUNCITIONS
 	*/
-	int  countParamsInWord(string symbolsAndLiterals);
 	unsigned int getLiteralInSkip(string literal);
-	void writeInstructionData(string code);
+	void writeWord(uint32_t word);
 	int getNumberFromLiteral(string literal);
 	int  getRegisterIndex(string reg);
-	char getHexfromInt(int num);
-	string formatHexData(string hexStr);
 	string formatNumberToHex(int num);
-	void writeArithmeticLogicInstruction(string regs, string opcode);
-	void writeBranchInstruction(string instr, string regsAndOperand, int inc, string hexNum);
-	int getOperandSize(string operand, string& hex);
-	void pushRegister(string reg);
-	void popRegister(string reg);
+	void writeArithmeticLogicInstruction(Statement& statement);
+	void writeBranchInstruction(Statement& statement);
+	OperandMode getOperandMode(string operand, OperandKind kind, unsigned int& literal);
+	bool fitsInDisplacement(unsigned int literal);
 	void checkIfRegisterIsValid(string operand);
 	void checkIfHexIsValid(string hexNum);
-	string getLoadStoreHexDisplacement(string disp);
+	int getLoadStoreDisplacement(string disp, OperandKind kind);
 	void errorMessage(string msg);
 	
 	/*
@@ -159,11 +245,15 @@ private:
 	void preprocessing();
 	void assemblerPass(int pass);
 	void createOutputFile();
+	void createTextOutputFile();
+	void createBinaryOutputFile();
+	unsigned int addToStringTable(Atom name, vector<char>& strtab, unordered_map<Atom, unsigned int>& strtabIndex);
 
 	/*
 	*	OUTPUT INFORMATION
 	*/
 	void printSectionData(ostream&);
+	string getSectionListing(Atom section);
 	void printRelocationTable(ostream&);
 	void printSectionTable(ostream&);
 	void printSymbolTable(ostream&);
@@ -171,8 +261,7 @@ private:
 	void info(ostream&);
 
 public:
-	Assembler(string inputFile, string outputFile);
-	~Assembler();
+	Assembler(string inputFile, string outputFile, bool textOutput);
 	void generateObjectFile();
 };
 
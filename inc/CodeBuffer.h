@@ -0,0 +1,34 @@
+#ifndef CODEBUFFER_H_
+#define CODEBUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+/*
+*	EXECUTABLE CODE BUFFER
+*	One mapping for all generated code. Pages are readable and executable
+*	and only made writable while a new piece of code is copied in. Code is
+*	never released before the buffer, so code still running or reachable
+*	from a retired block stays valid. A full buffer rejects new code.
+*/
+class CodeBuffer
+{
+private:
+	static const size_t BUFFER_SIZE = 16 * 1024 * 1024;
+	static const size_t CODE_ALIGNMENT = 16;
+
+	uint8_t* base;
+	size_t used;
+	size_t pageSize;
+
+public:
+	CodeBuffer();
+	~CodeBuffer();
+	bool isAvailable() const { return base != nullptr; }
+	const void* add(const vector<uint8_t>& code);
+};
+
+#endif
@@ -5,9 +5,24 @@
 #include <iomanip>
 #include <string>
 #include <sstream>
-#include <map>
 #include <fstream>
 #include <regex>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <fcntl.h>
+#include <termios.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ImageFile.h"
+#include "SpscQueue.h"
+#include "X86Emitter.h"
+#include "CodeBuffer.h"
 
 using namespace std;
 
@@ -15,30 +30,242 @@ class Emulator
 {
 private:
 	string inputFileName;
-	map<unsigned int, string> memory;
-	unsigned int r0, r1, r2, r3, r4, r5, r6, r7, r8, r9, r10, r11, r12, r13, r14, r15;
-	unsigned int& sp = r14;
-	unsigned int& pc = r15;
-	unsigned int status, handler, cause;
+
+	/*
+	*	MEMORY
+	*	Sparse page table over the whole 4 GiB address space.
+	*	Pages are allocated on first write, unallocated memory reads as zero.
+	*/
+#define PAGE_BITS		12
+#define PAGE_SIZE		(1u << PAGE_BITS)
+#define PAGE_COUNT		(1u << (32 - PAGE_BITS))
+
+	vector<unsigned char*> pageTable;
+
+	unsigned char* getPage(unsigned int address);
+	unsigned char readByte(unsigned int address);
+	void writeByte(unsigned int address, unsigned char value);
+	unsigned int readWord(unsigned int address);
+	void writeWord(unsigned int address, unsigned int value);
+
+	/*
+	*	TRANSLATED BLOCKS
+	*	Code runs as basic blocks, straight-line runs that end at a branch,
+	*	call, int, iret, halt, any other write to pc, or the end of a page.
+	*	A block is translated once into direct-threaded code, an array of ops
+	*	that each carry the address of their handler label inside
+	*	executeInstructions, and is looked up by its start address in a
+	*	per-page table. pc is only written for ops that read it and for the
+	*	last op, writes to r0 are dropped at translation. A block remembers
+	*	the blocks it last continued into, those links are valid while
+	*	blockEpoch is unchanged. A store into the translated range of a page
+	*	retires all its blocks.
+	*
+	*	Operands read pc-relative from a literal pool in the same page are
+	*	read once at translation and folded into the op, so ld $const becomes
+	*	a register move and a jump through the pool a direct jump. The pool
+	*	word counts as part of the translated range.
+	*/
+#define SLOTS_PER_PAGE		(PAGE_SIZE / 4)
+#define MAX_BLOCK_LENGTH	64
+
+#define LABEL_SET_PC		256			// sets pc, then runs target
+#define LABEL_BLOCK_END		257			// sentinel op closing every block
+#define LABEL_NOP			258
+#define LABEL_COUNT			259
+
+	typedef struct DecodedInstruction
+	{
+		unsigned char opcode = 0;		// OC << 4 | MOD
+		unsigned char a = 0;
+		unsigned char b = 0;
+		unsigned char c = 0;
+		unsigned int disp = 0;			// sign-extended 12-bit displacement
+	} DecodedInstruction;
+
+	typedef struct BlockOp
+	{
+		const void* label;				// handler in executeInstructions
+		const void* target;				// handler after LABEL_SET_PC
+		unsigned char opcode;
+		unsigned char a;
+		unsigned char b;
+		unsigned char c;
+		unsigned int disp;
+		unsigned int next;				// address of the following instruction
+	} BlockOp;
+
+	typedef unsigned int (*NativeBlock)();	// returns instructions executed
+
+	typedef struct TranslatedBlock
+	{
+		unsigned int start;
+		unsigned int end;
+		unsigned int low;				// bytes whose rewrite retires the block,
+		unsigned int high;				// code and folded literals
+		vector<BlockOp> ops;
+		unsigned int runCount;
+		NativeBlock native;
+		unsigned int chainEpoch;
+		unsigned int chainAddress[2];	// [0] branch target, [1] fall through
+		TranslatedBlock* chainBlock[2];
+	} TranslatedBlock;
+
+	typedef struct BlockPage
+	{
+		TranslatedBlock* slots[SLOTS_PER_PAGE];
+		vector<TranslatedBlock*> blocks;
+		unsigned int low;				// translated byte range in the page
+		unsigned int high;
+	} BlockPage;
+
+	vector<BlockPage*> blockPages;
+	vector<TranslatedBlock*> retiredBlocks;
+	unsigned int blockEpoch;
+	const void* const* opLabels;		// handler label per opcode
+	unsigned int runningPage;			// page of the block being executed
+	bool blockBroken;					// the running block has been retired
+
+	DecodedInstruction decodeInstruction(unsigned int word);
+	static bool endsBlock(const DecodedInstruction& ins);
+	void foldLiteral(DecodedInstruction& ins, unsigned int next, TranslatedBlock* block);
+	TranslatedBlock* translateBlock(unsigned int address);
+	TranslatedBlock* findBlock(unsigned int address);
+	TranslatedBlock* nextBlock(TranslatedBlock* previous, unsigned int address);
+	void invalidateBlocks(unsigned int address, unsigned int size);
+	void freeRetiredBlocks();
+
+	/*
+	*	JIT
+	*	With --jit a block that has run jitThreshold times is compiled to
+	*	x86-64 code in the code buffer and called instead of its ops. The
+	*	busiest guest registers of the block live in callee-saved host
+	*	registers while it runs, memory goes through the helpers below. The
+	*	code leaves early, like the threaded code, when a store retires the
+	*	block. Blocks with halt, int, iret or csr pops stay interpreted.
+	*/
+#define JIT_THRESHOLD		32
+#define JIT_PINNED_COUNT	5
+
+	unsigned int jitThreshold;			// 0 when the JIT is off
+	CodeBuffer* codeBuffer;
+
+	bool compileBlock(TranslatedBlock* block);
+	static uint32_t jitReadWord(Emulator* emu, uint32_t address);
+	static void jitWriteWord(Emulator* emu, uint32_t address, uint32_t value);
+	static void jitCsrWritten(Emulator* emu);
+
+	/*
+	*	REGISTER FILE
+	*/
+#define GPR_COUNT		16
+#define CSR_COUNT		3
+
+#define SP				14
+#define PC				15
+
+#define STATUS			0
+#define HANDLER			1
+#define CAUSE			2
+
+	uint32_t gpr[GPR_COUNT];
+	uint32_t csr[CSR_COUNT];
 
 	const unsigned int interruptMask = 0x00000004;
 	const unsigned int terminalMask  = 0x00000002;
 	const unsigned int timerMask     = 0x00000001;
 
+#define CAUSE_TIMER		2
+#define CAUSE_TERMINAL	3
+#define CAUSE_SOFTWARE	4
+
+	/*
+	*	EVENT SCHEDULER
+	*	Device time is virtual and counted in executed instructions, so runs
+	*	are repeatable. Events wait in a queue ordered by due time and the
+	*	main loop only compares the instruction count with the earliest one.
+	*	Pending interrupts use the same bits as their status masks.
+	*/
+#define INSTRUCTIONS_PER_MS		100000
+
+	typedef enum DeviceEvent
+	{
+		EVENT_TIMER,
+		EVENT_TERMINAL
+	} DeviceEvent;
+
+	typedef struct ScheduledEvent
+	{
+		uint64_t time;
+		DeviceEvent device;
+		unsigned int generation;		// stale once the device is reprogrammed
+
+		bool operator>(const ScheduledEvent& other) const { return time > other.time; }
+	} ScheduledEvent;
+
+	priority_queue<ScheduledEvent, vector<ScheduledEvent>, greater<ScheduledEvent>> events;
+	uint64_t instructionCount;
+	uint64_t nextEventTime;
+	unsigned int pendingInterrupts;
+
+	void scheduleEvent(DeviceEvent device, uint64_t delay, unsigned int generation);
+	void handleEvents();
+	void recheckInterrupts();
+	void acceptInterrupt(unsigned int cause);
+
+	/*
+	*	TIMER
+	*	tim_cfg selects the period, a write restarts the timer.
+	*/
+#define DEVICE_BASE		0xFFFFFF00
+#define TIM_CFG			0xFFFFFF10
+
+	unsigned int timerGeneration;
+
+	void startTimer();
+	void writeDeviceRegister(unsigned int address, unsigned int size);
+	void readDeviceRegister(unsigned int address, unsigned int size);
+
+	/*
+	*	TERMINAL
+	*	Characters stored to term_out are collected and written out on a
+	*	newline, on a poll that finds output waiting and on halt. A reader
+	*	thread blocks on stdin and hands characters over through a lock-free
+	*	queue, the poll event moves one at a time into term_in and requests
+	*	a terminal interrupt, so the interpreter never waits for I/O.
+	*	The reader and raw mode start on the first load from term_in or once
+	*	a handler is set with terminal interrupts unmasked, programs that
+	*	only print leave stdin alone.
+	*/
+#define TERM_OUT				0xFFFFFF00
+#define TERM_IN					0xFFFFFF04
+#define TERMINAL_POLL_INTERVAL	10000		// instructions
+#define TERMINAL_QUEUE_SIZE		1024
+
+	typedef SpscQueue<char, TERMINAL_QUEUE_SIZE> InputQueue;
+
+	string terminalOutput;
+	shared_ptr<InputQueue> terminalInput;
+
+	void startTerminal();
+	void startTerminalInput();
+	void restoreTerminal();
+	void pollTerminal();
+	void flushTerminal();
+
 	void errorMessage(string msg);
 	int hexToInt(char c);
 	unsigned int getIntValueFromHex(string hex);
-	string getHexValue(unsigned int val);
-	unsigned int& getGPRegister(char index);
-	unsigned int& getCSRegister(char index);
-	string formatHexData(string hex);
 
 	void loadProgramInMemory();
+	bool loadImageInMemory();
+	void loadSegment(unsigned int address, const unsigned char* data, unsigned int size);
 	void executeInstructions();
 	void outputFinalState();
 
 public:
-	Emulator(string inputHexFile);
+	Emulator(string inputHexFile, unsigned int jitThreshold);
+	~Emulator();
 	void executeHexProgeam();
 };
 
@@ -0,0 +1,165 @@
+#ifndef ENCODING_H_
+#define ENCODING_H_
+
+#include <cstdint>
+#include "parser.h"
+
+/*
+*	INSTRUCTION ENCODING
+*	Every instruction word is stored as OC|MOD, A|B, C|D[11:8], D[7:0].
+*	One row per instruction form and operand mode gives the opcode byte,
+*	where the source registers go, a fixed displacement added to the operand
+*	and the number of bytes the whole form takes in the section.
+*/
+#define ENC_SP				14
+#define ENC_PC				15
+
+typedef enum OperandMode
+{
+	MODE_REGISTER,		// registers and an optional 12-bit displacement
+	MODE_INLINE,		// literal operand that fits in D
+	MODE_RELATIVE,		// pc-relative to a label in the same section
+	MODE_POOL,			// operand read pc-relative from a literal pool
+	MODE_SECOND_WORD	// word following a two word form
+} OperandMode;
+
+typedef enum EncodingField
+{
+	FIELD_ZERO,
+	FIELD_ONE,
+	FIELD_REG1,			// first register in the source line
+	FIELD_REG2,			// second register in the source line
+	FIELD_SP,
+	FIELD_PC
+} EncodingField;
+
+typedef struct InstructionEncoding
+{
+	LineType type;
+	OperandMode mode;
+	uint8_t opcode;
+	EncodingField a;
+	EncodingField b;
+	EncodingField c;
+	int disp;
+	unsigned int size;
+} InstructionEncoding;
+
+constexpr InstructionEncoding encodingTable[] =
+{
+	{ INSTRUCTION_HALT,            MODE_REGISTER,    0x00, FIELD_ZERO, FIELD_ZERO, FIELD_ZERO,  0, 4 },
+	{ INSTRUCTION_INT,             MODE_REGISTER,    0x10, FIELD_ZERO, FIELD_ZERO, FIELD_ZERO,  0, 4 },
+	{ INSTRUCTION_IRET,            MODE_REGISTER,    0x93, FIELD_PC,   FIELD_SP,   FIELD_ONE,   4, 8 },
+	{ INSTRUCTION_IRET,            MODE_SECOND_WORD, 0x97, FIELD_ZERO, FIELD_SP,   FIELD_ZERO,  4, 0 },
+	{ INSTRUCTION_CALL,            MODE_INLINE,      0x20, FIELD_ZERO, FIELD_ZERO, FIELD_ZERO,  0, 4 },
+	{ INSTRUCTION_CALL,            MODE_RELATIVE,    0x20, FIELD_PC,   FIELD_ZERO, FIELD_ZERO,  0, 4 },
+	{ INSTRUCTION_CALL,            MODE_POOL,        0x21, FIELD_PC,   FIELD_ZERO, FIELD_ZERO,  0, 4 },
+	{ INSTRUCTION_RET,             MODE_REGISTER,    0x93, FIELD_PC,   FIELD_SP,   FIELD_ZERO,  4, 4 },
+	{ INSTRUCTION_JMP,             MODE_INLINE,      0x30, FIELD_ZERO, FIELD_ZERO, FIELD_ZERO,  0, 4 },
+	{ INSTRUCTION_JMP,             MODE_RELATIVE,    0x30, FIELD_PC,   FIELD_ZERO, FIELD_ZERO,  0, 4 },
+	{ INSTRUCTION_JMP,             MODE_POOL,        0x38, FIELD_PC,   FIELD_ZERO, FIELD_ZERO,  0, 4 },
+	{ INSTRUCTION_BEQ,             MODE_INLINE,      0x31, FIELD_ZERO, FIELD_REG1, FIELD_REG2,  0, 4 },
+	{ INSTRUCTION_BEQ,             MODE_RELATIVE,    0x31, FIELD_PC,   FIELD_REG1, FIELD_REG2,  0, 4 },
+	{ INSTRUCTION_BEQ,             MODE_POOL,        0x39, FIELD_PC,   FIELD_REG1, FIELD_REG2,  0, 4 },
+	{ INSTRUCTION_BNE,             MODE_INLINE,      0x32, FIELD_ZERO, FIELD_REG1, FIELD_REG2,  0, 4 },
+	{ INSTRUCTION_BNE,             MODE_RELATIVE,    0x32, FIELD_PC,   FIELD_REG1, FIELD_REG2,  0, 4 },
+	{ INSTRUCTION_BNE,             MODE_POOL,        0x3A, FIELD_PC,   FIELD_REG1, FIELD_REG2,  0, 4 },
+	{ INSTRUCTION_BGT,             MODE_INLINE,      0x33, FIELD_ZERO, FIELD_REG1, FIELD_REG2,  0, 4 },
+	{ INSTRUCTION_BGT,             MODE_RELATIVE,    0x33, FIELD_PC,   FIELD_REG1, FIELD_REG2,  0, 4 },
+	{ INSTRUCTION_BGT,             MODE_POOL,        0x3B, FIELD_PC,   FIELD_REG1, FIELD_REG2,  0, 4 },
+	{ INSTRUCTION_PUSH,            MODE_REGISTER,    0x81, FIELD_SP,   FIELD_ZERO, FIELD_REG1, -4, 4 },
+	{ INSTRUCTION_POP,             MODE_REGISTER,    0x93, FIELD_REG1, FIELD_SP,   FIELD_ZERO,  4, 4 },
+	{ INSTRUCTION_XCHG,            MODE_REGISTER,    0x40, FIELD_ZERO, FIELD_REG2, FIELD_REG1,  0, 4 },
+	{ INSTRUCTION_ADD,             MODE_REGISTER,    0x50, FIELD_REG2, FIELD_REG2, FIELD_REG1,  0, 4 },
+	{ INSTRUCTION_SUB,             MODE_REGISTER,    0x51, FIELD_REG2, FIELD_REG2, FIELD_REG1,  0, 4 },
+	{ INSTRUCTION_MUL,             MODE_REGISTER,    0x52, FIELD_REG2, FIELD_REG2, FIELD_REG1,  0, 4 },
+	{ INSTRUCTION_DIV,             MODE_REGISTER,    0x53, FIELD_REG2, FIELD_REG2, FIELD_REG1,  0, 4 },
+	{ INSTRUCTION_NOT,             MODE_REGISTER,    0x60, FIELD_REG1, FIELD_REG1, FIELD_ZERO,  0, 4 },
+	{ INSTRUCTION_AND,             MODE_REGISTER,    0x61, FIELD_REG2, FIELD_REG2, FIELD_REG1,  0, 4 },
+	{ INSTRUCTION_OR,              MODE_REGISTER,    0x62, FIELD_REG2, FIELD_REG2, FIELD_REG1,  0, 4 },
+	{ INSTRUCTION_XOR,             MODE_REGISTER,    0x63, FIELD_REG2, FIELD_REG2, FIELD_REG1,  0, 4 },
+	{ INSTRUCTION_SHL,             MODE_REGISTER,    0x70, FIELD_REG2, FIELD_REG2, FIELD_REG1,  0, 4 },
+	{ INSTRUCTION_SHR,             MODE_REGISTER,    0x71, FIELD_REG2, FIELD_REG2, FIELD_REG1,  0, 4 },
+	{ INSTRUCTION_CSRRD,           MODE_REGISTER,    0x90, FIELD_REG2, FIELD_REG1, FIELD_ZERO,  0, 4 },
+	{ INSTRUCTION_CSRWR,           MODE_REGISTER,    0x94, FIELD_REG2, FIELD_REG1, FIELD_ZERO,  0, 4 },
+	{ INSTRUCTION_LOAD_IMMED,      MODE_INLINE,      0x91, FIELD_REG2, FIELD_ZERO, FIELD_ZERO,  0, 4 },
+	{ INSTRUCTION_LOAD_IMMED,      MODE_POOL,        0x92, FIELD_REG2, FIELD_PC,   FIELD_ZERO,  0, 4 },
+	{ INSTRUCTION_LOAD_MEMDIR,     MODE_INLINE,      0x92, FIELD_REG2, FIELD_ZERO, FIELD_ZERO,  0, 4 },
+	{ INSTRUCTION_LOAD_MEMDIR,     MODE_POOL,        0x92, FIELD_REG2, FIELD_PC,   FIELD_ZERO,  0, 8 },
+	{ INSTRUCTION_LOAD_MEMDIR,     MODE_SECOND_WORD, 0x92, FIELD_REG2, FIELD_REG2, FIELD_ZERO,  0, 0 },
+	{ INSTRUCTION_LOAD_REGDIR,     MODE_REGISTER,    0x91, FIELD_REG2, FIELD_REG1, FIELD_ZERO,  0, 4 },
+	{ INSTRUCTION_LOAD_REGIND,     MODE_REGISTER,    0x92, FIELD_REG2, FIELD_REG1, FIELD_ZERO,  0, 4 },
+	{ INSTRUCTION_LOAD_REGINDDISP, MODE_REGISTER,    0x92, FIELD_REG2, FIELD_REG1, FIELD_ZERO,  0, 4 },
+	{ INSTRUCTION_STORE_MEMDIR,    MODE_INLINE,      0x80, FIELD_ZERO, FIELD_ZERO, FIELD_REG1,  0, 4 },
+	{ INSTRUCTION_STORE_MEMDIR,    MODE_POOL,        0x82, FIELD_PC,   FIELD_ZERO, FIELD_REG1,  0, 4 },
+	{ INSTRUCTION_STORE_REGDIR,    MODE_REGISTER,    0x91, FIELD_REG2, FIELD_REG1, FIELD_ZERO,  0, 4 },
+	{ INSTRUCTION_STORE_REGIND,    MODE_REGISTER,    0x80, FIELD_REG2, FIELD_ZERO, FIELD_REG1,  0, 4 },
+	{ INSTRUCTION_STORE_REGINDDISP, MODE_REGISTER,   0x80, FIELD_REG2, FIELD_ZERO, FIELD_REG1,  0, 4 }
+};
+
+constexpr int findEncoding(LineType type, OperandMode mode)
+{
+	for (unsigned int i = 0; i < sizeof(encodingTable) / sizeof(encodingTable[0]); i++)
+	{
+		if ((encodingTable[i].type == type) && (encodingTable[i].mode == mode)) return i;
+	}
+	return -1;
+}
+
+constexpr unsigned int getInstructionSize(LineType type, OperandMode mode)
+{
+	int row = findEncoding(type, mode);
+	return (row == -1) ? 0 : encodingTable[row].size;
+}
+
+constexpr int getEncodingField(EncodingField field, int reg1, int reg2)
+{
+	switch (field)
+	{
+	case FIELD_ONE: return 1;
+	case FIELD_REG1: return reg1;
+	case FIELD_REG2: return reg2;
+	case FIELD_SP: return ENC_SP;
+	case FIELD_PC: return ENC_PC;
+	default: return 0;
+	}
+}
+
+/*
+*	Registers are passed in source line order, the row places them.
+*	disp is added to the fixed displacement and cut to 12 bits.
+*/
+template <LineType Op, OperandMode Mode>
+constexpr uint32_t encode(int reg1, int reg2, int disp)
+{
+	constexpr int row = findEncoding(Op, Mode);
+	static_assert(row != -1, "No encoding for this instruction form");
+	constexpr InstructionEncoding e = encodingTable[row];
+
+	int d = e.disp + disp;
+	uint32_t word = e.opcode;
+	word |= (uint32_t)(getEncodingField(e.a, reg1, reg2) & 0xF) << 12;
+	word |= (uint32_t)(getEncodingField(e.b, reg1, reg2) & 0xF) << 8;
+	word |= (uint32_t)(getEncodingField(e.c, reg1, reg2) & 0xF) << 20;
+	word |= (uint32_t)(d & 0xF00) << 8;
+	word |= (uint32_t)(d & 0xFF) << 24;
+	return word;
+}
+
+/*
+*	Same for a form whose operand mode is only known at run time.
+*/
+template <LineType Op>
+constexpr uint32_t encode(OperandMode mode, int reg1, int reg2, int disp)
+{
+	if constexpr (findEncoding(Op, MODE_RELATIVE) != -1)
+	{
+		if (mode == MODE_RELATIVE) return encode<Op, MODE_RELATIVE>(reg1, reg2, disp);
+	}
+	if (mode == MODE_POOL) return encode<Op, MODE_POOL>(reg1, reg2, disp);
+	return encode<Op, MODE_INLINE>(reg1, reg2, disp);
+}
+
+static_assert(encode<INSTRUCTION_LOAD_IMMED, MODE_POOL>(0, 1, 0x7FC) == 0xFC071F92, "Encoding table does not match the word layout");
+
+#endif
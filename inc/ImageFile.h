@@ -0,0 +1,34 @@
+#ifndef IMAGEFILE_H_
+#define IMAGEFILE_H_
+
+#include <cstdint>
+
+/*
+*	BINARY MEMORY IMAGE
+*	Written by the linker and mapped by the emulator, all fields are stored
+*	in host byte order. Each segment is a run of consecutive bytes that is
+*	loaded at its address, data of every segment is 4-byte aligned.
+*
+*		ImageFileHeader
+*		ImageSegment[segmentCount]
+*		segment data
+*/
+#define IMG_MAGIC			0x474D497F		// "\x7FIMG"
+#define IMG_VERSION			1
+
+typedef struct ImageFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t segmentCount;
+	uint32_t segmentTableOffset;
+} ImageFileHeader;
+
+typedef struct ImageSegment
+{
+	uint32_t address;
+	uint32_t size;
+	uint32_t dataOffset;			// offset in file
+} ImageSegment;
+
+#endif
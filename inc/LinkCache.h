@@ -0,0 +1,36 @@
+#ifndef LINKCACHE_H_
+#define LINKCACHE_H_
+
+#include <cstdint>
+
+/*
+*	INCREMENTAL LINK CACHE
+*	Written by the linker next to its output when run with --incremental
+*	and read back by the next incremental run. Every field is a 32-bit word
+*	in host byte order, a hash takes two words, a string is its length
+*	followed by its bytes and a byte run is padded to 4.
+*
+*		LinkCacheHeader
+*		placeCount x	address, section
+*		objectCount x	name, content hash, symbol hash, symtab begin,
+*						symtab count, section count,
+*						section count x (name, size, part offset, relocation count,
+*							relocation count x (offset, type, symbol, addend))
+*		sectionCount x	name, address, size, part count, part offsets, bytes
+*		symbolCount x	id, name, value, type, section id, binding
+*/
+#define LDC_MAGIC			0x4B444C7F		// "\x7FLDK"
+#define LDC_VERSION			2
+
+typedef struct LinkCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t binaryOutput;
+	uint32_t placeCount;
+	uint32_t objectCount;
+	uint32_t sectionCount;
+	uint32_t symbolCount;
+} LinkCacheHeader;
+
+#endif
@@ -8,7 +8,23 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <regex>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ObjectFile.h"
+#include "ImageFile.h"
+#include "StringInterner.h"
+#include "LinkCache.h"
 
 using namespace std;
 
@@ -16,35 +32,38 @@ class Linker
 {
 private:
 	string outputFileName;
+	bool binaryOutput;
+	bool incremental;
+	unsigned int threadCount;
 	vector<string> objectFileNames;
 	map<string, string> placeSectionMap;
-	map<unsigned int, string> outputHexCode;
 	ofstream linkerInfo;
 
 	typedef struct SymbolTableEntry
 	{
 		int id = 0;
-		string name = "";
+		Atom name = 0;
 		unsigned int value = 0;
-		string type = "";
+		ObjectSymbolType type = STT_NOTYPE;
 		int sectionId = 0;
-		string binding = "";
+		ObjectSymbolBinding binding = STB_LOCAL;
 	} SymbolTableEntry;
 
 	typedef struct RelocationTableEntry
 	{
 		unsigned int offset = 0;
-		string type = "";
-		string symbol = "";
+		RelocationType type = R_ABS_32;
+		Atom symbol = 0;
 		int addend = 0;
 	} RelocationTableEntry;
 
 	typedef struct ObjectFileData
 	{
-		map<string, unsigned int> sectionTable;
-		map<string, SymbolTableEntry> symbolTable;
-		map<string, map<unsigned int, RelocationTableEntry>> sectionRelocationTable;
-		map<string, map<unsigned int, string>> sectionCodeData;
+		vector<Atom> sections;				// in object file order
+		unordered_map<Atom, unsigned int> sectionTable;
+		unordered_map<Atom, SymbolTableEntry> symbolTable;
+		unordered_map<Atom, vector<RelocationTableEntry>> sectionRelocationTable;	// by offset
+		unordered_map<Atom, vector<uint8_t>> sectionData;
 	} ObjectFileData;
 
 	typedef struct ObjectFileDataList
@@ -52,6 +71,13 @@ private:
 		string name;
 		ObjectFileData data;
 		ObjectFileDataList* next = nullptr;
+
+		uint64_t hash = 0;								// of the file contents
+		uint64_t symbolSignature = 0;					// of the symbol table without values
+		unsigned int symtabBegin = 0;					// first entry added to the merged symtab
+		unsigned int symtabCount = 0;
+		unordered_map<Atom, unsigned int> partOffset;	// of each section in the placed section
+		bool changed = true;							// relocations of this file need patching
 	} ObjectFileDataList;
 
 	ObjectFileDataList* objFileDataList, *objFileDataListTail;
@@ -62,7 +88,10 @@ private:
 	{
 		unsigned int address = 0;
 		unsigned int size = 0;
-		string name = "";
+		Atom name = 0;
+		vector<uint8_t> bytes;				// placed contents, relocations patched in place
+		vector<unsigned int> parts;			// offset where each object's part begins
+		vector<unsigned int> relocations;	// offsets of relocated words, ascending
 	} SectionHeaderEntry;
 
 	typedef struct SectionHeaderList
@@ -73,44 +102,113 @@ private:
 
 	SectionHeaderList* shdr, *shdrTail;
 
-	void addNewSectionHeaderEntry(unsigned int address, unsigned int size, string name);
+	void addNewSectionHeaderEntry(unsigned int address, unsigned int size, Atom name);
 	void deleteSectionHeaderList();
+	vector<SectionHeaderEntry*> getSectionsByAddress();
 	void printSectionHeader(ostream& os);
 
-	typedef struct SymbolTableList
+	/*
+	*	Walks the placed sections word by word in address order. Words are
+	*	counted from the start of each object's part, so a part whose size
+	*	is not a multiple of four ends in a short word.
+	*/
+	typedef struct WordCursor
 	{
-		SymbolTableEntry entry;
-		SymbolTableList* next = nullptr;
-	} SymbolTableList;
-
-	SymbolTableList* symtab, *symtabTail;
+		vector<SectionHeaderEntry*> sections;
+		size_t section = 0;
+		size_t part = 0;
+		unsigned int offset = 0;
+		size_t relocation = 0;
 
-	void addNewSymbolTableEntry(int id, string name, unsigned int value, string type, int sectionId, string binding);
-	int getSymbolID(string symbol);
-	unsigned int getSymbolValue(string symbol);
-	void deleteSymbolTableList();
+		unsigned int address = 0;
+		unsigned int size = 0;
+		const uint8_t* bytes = nullptr;
+		bool relocated = false;
+
+		WordCursor(vector<SectionHeaderEntry*> sections);
+		bool next();
+	} WordCursor;
+
+	/*
+	*	Merged symbol table, symtabIndex maps a name to its first entry.
+	*/
+	vector<SymbolTableEntry> symtab;
+	unordered_map<Atom, int> symtabIndex;
+
+	void addNewSymbolTableEntry(int id, Atom name, unsigned int value, ObjectSymbolType type, int sectionId, ObjectSymbolBinding binding);
+	int getSymbolID(Atom symbol);
+	unsigned int getSymbolValue(Atom symbol);
 	void printSymbolTable(ostream& os);
 
+	/*
+	*	One relocation to apply, the target points into the placed section.
+	*/
+#define PATCH_RANGE_SIZE	1024
+
+	typedef struct RelocationPatch
+	{
+		const RelocationTableEntry* record;
+		uint8_t* target;
+	} RelocationPatch;
+
+	void applyRelocations(const vector<RelocationPatch>& patches, size_t begin, size_t end);
+
 	int hexToInt(char c);
-	string formatHexData(unsigned int value);
 	unsigned int getAddressValue(string hex);
 	void checkAddressOverflow(unsigned int base, unsigned int offset);
 	void errorMessage(string msg);
 	void insertData(ObjectFileData& data, ifstream& file);
-	void printHexCode(ostream& os);
+	bool readBinaryObjectFile(ObjectFileData& data, string fileName);
+	void insertBinaryData(ObjectFileData& data, const char* image, size_t size, string fileName);
+	void printHexCode(ostream& os, bool patched);
 	void printRelocationTable(ostream& os);
+	void sortRelocationTable(vector<RelocationTableEntry>& table);
 
+	void readObjectFile(ObjectFileDataList* objFile);
 	void readObjectFiles();
 	void checkSymbolsForError();
 	void checkSectionsForOverlapping();
 	void updateSymbolTable();
 	void updateCodeAddresses();
 	void updateRelocationTable();
+	void collectSectionRelocations();
 	void rewriteRelocationData();
 	void createOutputFile();
+	void createHexOutputFile();
+	void createImageOutputFile();
+
+	/*
+	*	INCREMENTAL LINKING
+	*	The layout, the merged symbol table, every relocation and the placed
+	*	bytes are kept in a cache. A changed object whose sections and symbols
+	*	keep their shape only has its bytes copied in again, its own relocations
+	*	and the relocations using its symbols are patched again.
+	*/
+	typedef struct CacheReader
+	{
+		vector<char> data;
+		size_t position = 0;
+		bool failed = false;
+
+		uint32_t word();
+		uint64_t hash();
+		string str();
+		const uint8_t* bytes(size_t size);
+	} CacheReader;
+
+	unordered_set<Atom> changedSymbols;
+
+	uint64_t hashObjectFile(string fileName);
+	uint64_t getSymbolSignature(ObjectFileData& data);
+	string getCacheFileName();
+	void clearLinkState();
+	bool loadLinkCache();
+	bool relinkObjectFile(ObjectFileDataList* objFile, unordered_map<Atom, SectionHeaderEntry*>& sections);
+	bool relinkFromCache();
+	void saveLinkCache();
 
 public:
-	Linker(string outputFile, vector<string> inputFileList, map<string, string> placeSection);
+	Linker(string outputFile, vector<string> inputFileList, map<string, string> placeSection, bool binaryOutput, unsigned int threadCount, bool incremental);
 	~Linker();
 	void generateHexFile();
 };
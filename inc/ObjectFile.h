@@ -0,0 +1,112 @@
+#ifndef OBJECTFILE_H_
+#define OBJECTFILE_H_
+
+#include <cstdint>
+
+/*
+*	BINARY OBJECT FILE
+*	Written by the assembler and read in place by the linker, all fields
+*	are stored in host byte order and every table is 4-byte aligned.
+*
+*		ObjectFileHeader
+*		ObjectSection[sectionCount]
+*		ObjectSymbol[symbolCount]
+*		ObjectRelocation[relocationCount]	(grouped by section)
+*		section data						(each section padded to 4 bytes)
+*		string table						(offset 0 is the empty name)
+*/
+#define OBJ_MAGIC			0x4A424F7F		// "\x7FOBJ"
+#define OBJ_VERSION			1
+
+#define OBJ_SYM_NOTYPE		0
+#define OBJ_SYM_SECTION		1
+
+#define OBJ_BIND_LOCAL		0
+#define OBJ_BIND_GLOBAL		1
+#define OBJ_BIND_EXTERN		2
+#define OBJ_BIND_UNDEFINED	3
+
+#define OBJ_REL_ABS_32		0
+#define OBJ_REL_SEO_32		1
+
+typedef enum RelocationType
+{
+	R_ABS_32 = OBJ_REL_ABS_32,		// symbol value
+	R_SEO_32 = OBJ_REL_SEO_32		// section start plus addend
+} RelocationType;
+
+inline const char* getRelocationTypeName(RelocationType type)
+{
+	return (type == R_SEO_32) ? "R_SEO_32" : "R_ABS_32";
+}
+
+typedef enum ObjectSymbolType
+{
+	STT_NOTYPE = OBJ_SYM_NOTYPE,
+	STT_SECTION = OBJ_SYM_SECTION
+} ObjectSymbolType;
+
+inline const char* getSymbolTypeName(ObjectSymbolType type)
+{
+	return (type == STT_SECTION) ? "SECTION" : "NOTYPE";
+}
+
+typedef enum ObjectSymbolBinding
+{
+	STB_LOCAL = OBJ_BIND_LOCAL,
+	STB_GLOBAL = OBJ_BIND_GLOBAL,
+	STB_EXTERN = OBJ_BIND_EXTERN,
+	STB_UNDEFINED = OBJ_BIND_UNDEFINED
+} ObjectSymbolBinding;
+
+inline const char* getSymbolBindingName(ObjectSymbolBinding binding)
+{
+	if (binding == STB_LOCAL) return "LOCAL";
+	if (binding == STB_GLOBAL) return "GLOBAL";
+	if (binding == STB_EXTERN) return "EXTERN";
+	return "UNDEFINED";
+}
+
+typedef struct ObjectFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t sectionCount;
+	uint32_t symbolCount;
+	uint32_t relocationCount;
+	uint32_t stringTableSize;
+	uint32_t sectionTableOffset;
+	uint32_t symbolTableOffset;
+	uint32_t relocationTableOffset;
+	uint32_t stringTableOffset;
+} ObjectFileHeader;
+
+typedef struct ObjectSection
+{
+	uint32_t name;					// offset in string table
+	uint32_t size;
+	uint32_t dataOffset;			// offset in file
+	uint32_t relocationIndex;		// first relocation of this section
+	uint32_t relocationCount;
+} ObjectSection;
+
+typedef struct ObjectSymbol
+{
+	uint32_t name;
+	uint32_t id;
+	uint32_t value;
+	uint32_t sectionId;				// 0 for undefined and extern symbols
+	uint8_t type;
+	uint8_t binding;
+	uint16_t reserved;
+} ObjectSymbol;
+
+typedef struct ObjectRelocation
+{
+	uint32_t offset;				// from the start of the section
+	uint32_t type;
+	uint32_t symbol;				// offset in string table
+	int32_t addend;
+} ObjectRelocation;
+
+#endif
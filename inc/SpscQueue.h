@@ -0,0 +1,46 @@
+#ifndef SPSCQUEUE_H_
+#define SPSCQUEUE_H_
+
+#include <atomic>
+
+using namespace std;
+
+/*
+*	SINGLE PRODUCER SINGLE CONSUMER QUEUE
+*	Fixed ring of Size slots shared by exactly one writer thread and one
+*	reader thread without locks. Each side owns one index and only reads
+*	the other one, so push and pop never wait. Size must be a power of two.
+*/
+template <typename T, unsigned int Size>
+class SpscQueue
+{
+private:
+	static_assert((Size & (Size - 1)) == 0, "Queue size must be a power of two");
+
+	T slots[Size];
+	atomic<unsigned int> head;		// next slot to pop, written by the consumer
+	atomic<unsigned int> tail;		// next slot to push, written by the producer
+
+public:
+	SpscQueue() : head(0), tail(0) {}
+
+	bool push(const T& value)
+	{
+		unsigned int t = tail.load(memory_order_relaxed);
+		if (t - head.load(memory_order_acquire) == Size) return false;
+		slots[t & (Size - 1)] = value;
+		tail.store(t + 1, memory_order_release);
+		return true;
+	}
+
+	bool pop(T& value)
+	{
+		unsigned int h = head.load(memory_order_relaxed);
+		if (h == tail.load(memory_order_acquire)) return false;
+		value = slots[h & (Size - 1)];
+		head.store(h + 1, memory_order_release);
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef STRINGINTERNER_H_
+#define STRINGINTERNER_H_
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+/*
+*	STRING INTERNER
+*	Every distinct name is stored once and identified by a 32-bit atom,
+*	so tables compare and hash names as integers. Atom 0 is the empty name.
+*	One interner is shared by all threads of the process. Names are spread
+*	over shards by their hash, each shard with its own lock, so threads
+*	interning different names rarely wait for each other. The low bits of
+*	an atom select its shard, the rest index the shard's names.
+*/
+typedef uint32_t Atom;
+
+#define NO_ATOM				0xFFFFFFFF		// find of a name never interned
+#define INTERNER_SHARD_BITS	4
+#define INTERNER_SHARDS		(1 << INTERNER_SHARD_BITS)
+
+class StringInterner
+{
+private:
+	typedef struct Shard
+	{
+		mutex lock;
+		deque<string> names;				// elements never move
+		unordered_map<string, Atom> atoms;
+	} Shard;
+
+	typedef struct Pool
+	{
+		Shard shards[INTERNER_SHARDS];
+
+		Pool();
+	} Pool;
+
+	static Pool& pool();
+	static unsigned int shardOf(const string& name);
+
+public:
+	static Atom intern(const string& name);
+	static Atom find(const string& name);
+	static const string& name(Atom atom);
+};
+
+#endif
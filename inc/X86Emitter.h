@@ -0,0 +1,89 @@
+#ifndef X86EMITTER_H_
+#define X86EMITTER_H_
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+/*
+*	X86-64 EMITTER
+*	Appends the handful of instruction forms the emulator's JIT needs to a
+*	byte vector. Register operations are 32-bit unless the name says
+*	otherwise. Memory operands are [base + disp32] with any base except
+*	rsp and r12, which would need a SIB byte.
+*/
+typedef enum HostRegister
+{
+	RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+	R8, R9, R10, R11, R12, R13, R14, R15
+} HostRegister;
+
+typedef enum AluOperation
+{
+	ALU_ADD = 0x01,
+	ALU_OR  = 0x09,
+	ALU_AND = 0x21,
+	ALU_SUB = 0x29,
+	ALU_XOR = 0x31,
+	ALU_CMP = 0x39
+} AluOperation;
+
+typedef enum JumpCondition
+{
+	JUMP_ALWAYS         = 0xE9,
+	JUMP_ABOVE_OR_EQUAL = 0x83,
+	JUMP_EQUAL          = 0x84,
+	JUMP_NOT_EQUAL      = 0x85,
+	JUMP_LESS_OR_EQUAL  = 0x8E
+} JumpCondition;
+
+class X86Emitter
+{
+private:
+	vector<uint8_t> code;
+
+	void emitByte(uint8_t value);
+	void emitWord(uint32_t value);
+	void emitRex(bool wide, int reg, int base);
+	void emitMemoryOperand(int reg, HostRegister base, int32_t disp);
+
+public:
+	const vector<uint8_t>& getCode() const { return code; }
+	size_t position() const { return code.size(); }
+
+	void movRegReg(HostRegister dst, HostRegister src);
+	void movRegImm(HostRegister dst, uint32_t imm);
+	void movRegImm64(HostRegister dst, uint64_t imm);
+	void load(HostRegister dst, HostRegister base, int32_t disp);
+	void store(HostRegister base, int32_t disp, HostRegister src);
+	void storeImm(HostRegister base, int32_t disp, uint32_t imm);
+	void load64(HostRegister dst, HostRegister base, int32_t disp);
+	void store64(HostRegister base, int32_t disp, HostRegister src);
+	void loadStackSlot(HostRegister dst);
+	void storeStackSlot(HostRegister src);
+
+	void alu(AluOperation op, HostRegister dst, HostRegister src);
+	void addImm(HostRegister dst, uint32_t imm);
+	void addImm64(HostRegister dst, uint32_t imm);
+	void cmp64(HostRegister left, HostRegister base, int32_t disp);
+	void imul(HostRegister dst, HostRegister src);
+	void div(HostRegister src);
+	void notReg(HostRegister dst);
+	void shlCl(HostRegister dst);
+	void shrCl(HostRegister dst);
+	void cmpByteZero(HostRegister base);
+
+	void push64(HostRegister reg);
+	void pop64(HostRegister reg);
+	void subRsp(uint8_t imm);
+	void addRsp(uint8_t imm);
+	void call64(HostRegister target);
+	void ret();
+
+	size_t jumpForward(JumpCondition condition);
+	void bindJump(size_t patch);
+	void jumpBack(size_t target);
+};
+
+#endif
@@ -4,68 +4,86 @@
 #include <iostream>
 #include <fstream>
 #include <string>
-#include <regex>
+#include <vector>
 
 using namespace std;
 
-extern void formatLine(string& line);
-extern void removeTrailingZeros(string& line);
+typedef enum LineType
+{
+	LINE_UNKNOWN,
+	LINE_LABEL,
+
+	DIRECTIVE_GLOBAL,
+	DIRECTIVE_EXTERN,
+	DIRECTIVE_SECTION,
+	DIRECTIVE_WORD,
+	DIRECTIVE_SKIP,
+	DIRECTIVE_END,
+	DIRECTIVE_LTORG,
+
+	INSTRUCTION_HALT,
+	INSTRUCTION_INT,
+	INSTRUCTION_IRET,
+	INSTRUCTION_CALL,
+	INSTRUCTION_RET,
+	INSTRUCTION_JMP,
+	INSTRUCTION_BEQ,
+	INSTRUCTION_BNE,
+	INSTRUCTION_BGT,
+	INSTRUCTION_PUSH,
+	INSTRUCTION_POP,
+	INSTRUCTION_XCHG,
+	INSTRUCTION_ADD,
+	INSTRUCTION_SUB,
+	INSTRUCTION_MUL,
+	INSTRUCTION_DIV,
+	INSTRUCTION_NOT,
+	INSTRUCTION_AND,
+	INSTRUCTION_OR,
+	INSTRUCTION_XOR,
+	INSTRUCTION_SHL,
+	INSTRUCTION_SHR,
+	INSTRUCTION_CSRRD,
+	INSTRUCTION_CSRWR,
+	INSTRUCTION_LOAD_IMMED,
+	INSTRUCTION_LOAD_MEMDIR,
+	INSTRUCTION_LOAD_REGDIR,
+	INSTRUCTION_LOAD_REGIND,
+	INSTRUCTION_LOAD_REGINDDISP,
+	INSTRUCTION_STORE_IMMED,
+	INSTRUCTION_STORE_MEMDIR,
+	INSTRUCTION_STORE_REGDIR,
+	INSTRUCTION_STORE_REGIND,
+	INSTRUCTION_STORE_REGINDDISP
+} LineType;
 
-extern bool isDirectiveGlobal(string line);
-extern bool isDirectiveExtern(string line);
-extern bool isDirectiveSection(string line);
-extern bool isDirectiveWord(string line);
-extern bool isDirectiveSkip(string line);
-extern bool isDirectiveEnd(string line);
-extern bool isInstructionHalt(string line);
-extern bool isInstructionInt(string line);
-extern bool isInstructionIret(string line);
-extern bool isInstructionCall(string line);
-extern bool isInstructionRet(string line);
-extern bool isInstructionJmp(string line);
-extern bool isInstructionBeq(string line);
-extern bool isInstructionBne(string line);
-extern bool isInstructionBgt(string line);
-extern bool isInstructionPush(string line);
-extern bool isInstructionPop(string line);
-extern bool isInstructionExchange(string line);
-extern bool isInstructionAdd(string line);
-extern bool isInstructionSub(string line);
-extern bool isInstructionMul(string line);
-extern bool isInstructionDiv(string line);
-extern bool isInstructionNot(string line);
-extern bool isInstructionAnd(string line);
-extern bool isInstructionOr(string line);
-extern bool isInstructionXor(string line);
-extern bool isInstructionShl(string line);
-extern bool isInstructionShr(string line);
-extern bool isInstructionCsrrd(string line);
-extern bool isInstructionCsrwr(string line);
-extern bool isInstructionLoadImmed(string line);
-extern bool isInstructionLoadMemDir(string line);
-extern bool isInstructionLoadRegDir(string line);
-extern bool isInstructionLoadRegInd(string line);
-extern bool isInstructionLoadRegIndDisp(string line);
-extern bool isInstructionStoreImmed(string line);
-extern bool isInstructionStoreMemDir(string line);
-extern bool isInstructionStoreRegDir(string line);
-extern bool isInstructionStoreRegInd(string line);
-extern bool isInstructionStoreRegIndDisp(string line);
-extern bool isLabel(string line);
-extern bool isSymbol(string line);
-extern bool isHexLiteral(string line);
-extern bool isNumberLiteral(string line);
+typedef enum OperandKind
+{
+	OPERAND_NONE,
+	OPERAND_SYMBOL,
+	OPERAND_HEX,
+	OPERAND_NUMBER
+} OperandKind;
 
-extern string getLabelName(string line);
-extern string getFirstRegister(string line);
-extern string getSecondRegister(string line);
-extern string getBranchFirstReg(string line);
-extern string getBranchSecondReg(string line);
-extern string getBranchOperand(string line);
-extern string getLoadOperand(string line);
-extern string getLoadRegister(string line);
-extern string getStoreRegister(string line);
-extern string getStoreOperand(string line);
-extern string getIndDispRegister(string line);
-extern string getIndDispSymOrLit(string line);
-#endif
\ No newline at end of file
+/*
+*	Result of recognizing one formatted line.
+*	Registers are stored without '%' in the order they appear in the line,
+*	operand holds the symbol/literal part (without '$'), section or label name,
+*	params holds the comma separated list of .global, .extern and .word.
+*	Kinds tell whether operand and params are symbols or literals.
+*/
+typedef struct ParsedLine
+{
+	LineType type = LINE_UNKNOWN;
+	string reg1 = "";
+	string reg2 = "";
+	string operand = "";
+	OperandKind operandKind = OPERAND_NONE;
+	vector<string> params;
+	vector<OperandKind> paramKinds;
+} ParsedLine;
+
+extern void formatLine(string& line);
+extern void removeTrailingZeros(string& line);
+extern bool parseLine(const string& line, ParsedLine& parsed);
+#endif
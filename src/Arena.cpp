@@ -0,0 +1,40 @@
+#include "Arena.h"
+
+Arena::Arena()
+{
+	blocks = nullptr;
+	current = nullptr;
+	remaining = 0;
+}
+
+Arena::~Arena()
+{
+	while (blocks != nullptr)
+	{
+		Block* next = blocks->next;
+		free(blocks);
+		blocks = next;
+	}
+}
+
+void* Arena::allocate(size_t size, size_t alignment)
+{
+	size_t padding = (alignment - ((uintptr_t)current % alignment)) % alignment;
+	if (padding + size > remaining)
+	{
+		size_t blockSize = sizeof(Block) + size + alignment;
+		if (blockSize < BLOCK_SIZE) blockSize = BLOCK_SIZE;
+		Block* block = static_cast<Block*>(malloc(blockSize));
+		if (block == nullptr) throw bad_alloc();
+		block->next = blocks;
+		block->size = blockSize;
+		blocks = block;
+		current = reinterpret_cast<char*>(block) + sizeof(Block);
+		remaining = blockSize - sizeof(Block);
+		padding = (alignment - ((uintptr_t)current % alignment)) % alignment;
+	}
+	char* result = current + padding;
+	current = result + size;
+	remaining -= padding + size;
+	return result;
+}
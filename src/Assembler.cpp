@@ -1,215 +1,201 @@
 #include "Assembler.h"
 
-Assembler::Assembler(string inputFile, string outputFile)
+Assembler::Assembler(string inputFile, string outputFile, bool textOutput)
 {
 	inputFileName = inputFile;
 	outputFileName = outputFile;
+	this->textOutput = textOutput;
 
-	symtab = new SymbolTable(0, "", 0, NOTYPE, UND, LOCAL);
-	lastEntrySymtab = symtab;
-	symbolList = nullptr;
-	lastSymbolList = nullptr;
+	addSymbolTableEntry(symtab, symtabIndex, 0, 0, 0, NOTYPE, UND, LOCAL);
+	currentSectionName = 0;
 	sectab = nullptr;
 	lastEntrySectab = nullptr;
 	reltab = nullptr;
 	lastEntryReltab = nullptr;
 }
 
-Assembler::~Assembler()
+static unsigned int hashSymbolName(Atom name)
 {
-	deleteSymbolTable();
-	symtab = nullptr;
-	lastEntrySymtab = nullptr;
+	// Fibonacci hashing, atoms are dense small integers
+	return name * 2654435769u;
+}
 
-	deleteSectionTable();
-	sectab = nullptr;
-	lastEntrySectab = nullptr;
+int Assembler::SymbolIndex::find(Atom name, const vector<SymbolTableEntry>& table) const
+{
+	if (slots.size() == 0) return -1;
+	size_t mask = slots.size() - 1;
+	for (size_t i = (hashSymbolName(name) >> 8) & mask; slots[i] != -1; i = (i + 1) & mask)
+	{
+		if (table[slots[i]].name == name) return slots[i];
+	}
+	return -1;
+}
 
-	deleteRelocationTable();
-	reltab = nullptr;
-	lastEntryReltab = nullptr;
+void Assembler::SymbolIndex::insert(Atom name, int position, const vector<SymbolTableEntry>& table)
+{
+	if (find(name, table) != -1) return;
+
+	if (2 * (count + 1) > slots.size())
+	{
+		vector<int> oldSlots = slots;
+		size_t size = (slots.size() == 0) ? 64 : 2 * slots.size();
+		slots.assign(size, -1);
+		for (size_t i = 0; i < oldSlots.size(); i++)
+		{
+			if (oldSlots[i] == -1) continue;
+			size_t j = (hashSymbolName(table[oldSlots[i]].name) >> 8) & (size - 1);
+			while (slots[j] != -1) j = (j + 1) & (size - 1);
+			slots[j] = oldSlots[i];
+		}
+	}
+
+	size_t mask = slots.size() - 1;
+	size_t i = (hashSymbolName(name) >> 8) & mask;
+	while (slots[i] != -1) i = (i + 1) & mask;
+	slots[i] = position;
+	count++;
 }
 
-Assembler::SymbolTable::SymbolTable(int id, string name, unsigned int value, SymbolType type, int sectionId, SymbolBinding binding)
+void Assembler::addSymbolTableEntry(vector<SymbolTableEntry>& table, SymbolIndex& index, int id, Atom name, unsigned int value, SymbolType type, int sectionId, SymbolBinding binding)
 {
+	SymbolTableEntry entry;
 	entry.id = id;
 	entry.name = name;
 	entry.value = value;
 	entry.type = type;
 	entry.sectionId = sectionId;
 	entry.binding = binding;
-	next = nullptr;
+	table.push_back(entry);
+	index.insert(entry.name, table.size() - 1, table);
+}
+
+int Assembler::findSymbol(Atom name)
+{
+	return symtabIndex.find(name, symtab);
 }
 
-void Assembler::addNewSectionToSymtab(string name)
+void Assembler::addNewSectionToSymtab(Atom name)
 {
-	if (isInSymbolTable(name, symtab))
+	if (findSymbol(name) != -1)
 	{
-		currentSection = name;
+		currentSection = StringInterner::name(name);
+		currentSectionName = name;
 		return;
 		//errorMessage("Error, line " + to_string(lineNum) + ": Section '" + name + "' is already defined!");
 	}
 
-	int id = lastEntrySymtab->entry.id + 1;
-	currentSection = name;
+	int id = symtab.back().id + 1;
+	currentSection = StringInterner::name(name);
+	currentSectionName = name;
 	currentSectionID = id;
-	sectionLocationCounter[name] = 0;
+	sectionLocationCounter[currentSection] = 0;
 
-	SymbolTable* newEntry = new SymbolTable(id, name, 0, SECTION, id, LOCAL);
-	lastEntrySymtab->next = newEntry;
-	lastEntrySymtab = newEntry;
+	addSymbolTableEntry(symtab, symtabIndex, id, name, 0, SECTION, id, LOCAL);
 }
 
-void Assembler::addNewSymbolToSymtab(string name)
+void Assembler::addNewSymbolToSymtab(Atom name)
 {
-	if (isInSymbolTable(name, symbolList))
+	if (symbolListIndex.find(name, symbolList) != -1)
 	{
-		errorMessage("Error, line " + to_string(lineNum) + ": Symbol '" + name + "' is already defined!");
+		errorMessage("Error, line " + to_string(lineNum) + ": Symbol '" + StringInterner::name(name) + "' is already defined!");
 	}
 
 	if (currentSection == "")
 	{
-		errorMessage("Error, line " + to_string(lineNum) + ": Symbol '" + name + "' does not belong in any section!");
+		errorMessage("Error, line " + to_string(lineNum) + ": Symbol '" + StringInterner::name(name) + "' does not belong in any section!");
 	}
 
-	SymbolTable* newEntry = new SymbolTable(0, name, sectionLocationCounter[currentSection], NOTYPE, currentSectionID, LOCAL);
-	if (symbolList == nullptr) symbolList = newEntry;
-	else lastSymbolList->next = newEntry;
-	lastSymbolList = newEntry;
+	addSymbolTableEntry(symbolList, symbolListIndex, 0, name, sectionLocationCounter[currentSection], NOTYPE, currentSectionID, LOCAL);
 }
 
-void Assembler::addExternSymbolsToSymtab(string externSymbolList)
+void Assembler::addExternSymbolsToSymtab(const vector<Atom>& externSymbolList)
 {
-	string symbol = "";
-	for (int i = 0; i <= externSymbolList.length(); i++)
+	for (size_t i = 0; i < externSymbolList.size(); i++)
 	{
-		if ((externSymbolList[i] == ',') || (i == externSymbolList.length()))
+		Atom symbol = externSymbolList[i];
+		int position = findSymbol(symbol);
+		if (position != -1)
 		{
-			if (isInSymbolTable(symbol, symtab))
-			{
-				SymbolTable* cur = symtab;
-				while (cur->entry.name != symbol) cur = cur->next;
+			SymbolTableEntry& entry = symtab[position];
 
-				if (cur->entry.binding == GLOBAL || cur->entry.binding == LOCAL)
-				{
-					errorMessage("Error, line " + to_string(lineNum) + ": Symbol '" + symbol + "' is already defined in this file!");
-				}
-				if (cur->entry.binding == UNDEFINED)
-				{
-					cur->entry.binding = EXTERN;
-				}
+			if (entry.binding == GLOBAL || entry.binding == LOCAL)
+			{
+				errorMessage("Error, line " + to_string(lineNum) + ": Symbol '" + StringInterner::name(symbol) + "' is already defined in this file!");
 			}
-			else
+			if (entry.binding == UNDEFINED)
 			{
-				int id = lastEntrySymtab->entry.id + 1;
-				SymbolTable* newEntry = new SymbolTable(id, symbol, 0, NOTYPE, UND, EXTERN);
-				lastEntrySymtab->next = newEntry;
-				lastEntrySymtab = newEntry;
+				entry.binding = EXTERN;
 			}
-
-			symbol = "";
-			i++;
-			continue;
 		}
-		symbol += externSymbolList[i];
-	}
-}
-
-bool Assembler::isInSymbolTable(string name, SymbolTable* table)
-{
-	for (SymbolTable* cur = table; cur != nullptr; cur = cur->next)
-	{
-		if (cur->entry.name == name) return true;
+		else
+		{
+			int id = symtab.back().id + 1;
+			addSymbolTableEntry(symtab, symtabIndex, id, symbol, 0, NOTYPE, UND, EXTERN);
+		}
 	}
-	return false;
 }
 
 void Assembler::printSymbolTable(ostream& os)
 {
 	os << "\nSYMBOL_TABLE\n";
 	os << "ID    VALUE       TYPE      BINDING      SECTION      NAME" << endl;
-	for (SymbolTable* cur = symtab; cur != nullptr; cur = cur->next)
+	for (size_t i = 0; i < symtab.size(); i++)
 	{
-		os << left << setw(6) << setfill(' ') << cur->entry.id << right;
-		os << setfill('0') << setw(8) << hex << cur->entry.value;
+		SymbolTableEntry& entry = symtab[i];
+		os << left << setw(6) << setfill(' ') << entry.id << right;
+		os << setfill('0') << setw(8) << hex << entry.value;
 		os << dec << setfill(' ') << left << "    " << setw(10);
-		if (cur->entry.type == NOTYPE) os << "NOTYPE";
+		if (entry.type == NOTYPE) os << "NOTYPE";
 		else os << "SECTION";
 		os << setw(13);
-		if (cur->entry.binding == LOCAL) os << "LOCAL";
-		else if (cur->entry.binding == GLOBAL) os << "GLOBAL";
-		else if (cur->entry.binding == EXTERN) os << "EXTERN";
+		if (entry.binding == LOCAL) os << "LOCAL";
+		else if (entry.binding == GLOBAL) os << "GLOBAL";
+		else if (entry.binding == EXTERN) os << "EXTERN";
 		else os << "UNDEFINED";
 		os << setw(13);
-		if (cur->entry.sectionId) os << cur->entry.sectionId;
+		if (entry.sectionId) os << entry.sectionId;
 		else os << "UND";
-		os << cur->entry.name << endl;
-	}
-}
-
-void Assembler::deleteSymbolTable()
-{
-	SymbolTable* cur;
-	while (symtab != nullptr)
-	{
-		cur = symtab;
-		symtab = symtab->next;
-		delete cur;
+		os << StringInterner::name(entry.name) << endl;
 	}
 }
 
 void Assembler::combineSymbolTable()
 {
-	lastEntrySymtab->next = symbolList;
-	while (lastEntrySymtab->next != nullptr)
+	for (size_t i = 0; i < symbolList.size(); i++)
 	{
-		lastEntrySymtab->next->entry.id = lastEntrySymtab->entry.id + 1;
-		lastEntrySymtab = lastEntrySymtab->next;
+		SymbolTableEntry& entry = symbolList[i];
+		int id = symtab.back().id + 1;
+		addSymbolTableEntry(symtab, symtabIndex, id, entry.name, entry.value, entry.type, entry.sectionId, entry.binding);
 	}
-	symbolList = nullptr;
-	lastSymbolList = nullptr;
+	symbolList.clear();
+	symbolListIndex = SymbolIndex();
 }
 
-void Assembler::changeToGlobal(string symbol)
+void Assembler::changeToGlobal(Atom symbol)
 {
-	SymbolTable* cur;
-	for (cur = symtab; cur != nullptr; cur = cur->next)
+	int position = findSymbol(symbol);
+	if (position != -1)
 	{
-		if (cur->entry.name == symbol)
+		if (symtab[position].binding == LOCAL)
 		{
-			if (cur->entry.binding == LOCAL)
-			{
-				cur->entry.binding = GLOBAL;
-			}
-			return;
+			symtab[position].binding = GLOBAL;
 		}
+		return;
 	}
-	if (cur == nullptr)
-	{
-		int id = lastEntrySymtab->entry.id + 1;
-		SymbolTable* newEntry = new SymbolTable(id, symbol, 0, NOTYPE, UND, UNDEFINED);
-		lastEntrySymtab->next = newEntry;
-		lastEntrySymtab = newEntry;
-	}
+
+	int id = symtab.back().id + 1;
+	addSymbolTableEntry(symtab, symtabIndex, id, symbol, 0, NOTYPE, UND, UNDEFINED);
 }
 
-void Assembler::setSymbolsToGlobal(string symbolList)
+void Assembler::setSymbolsToGlobal(const vector<Atom>& symbolList)
 {
-	string symbol = "";
-	for (int i = 0; i <= symbolList.length(); i++)
+	for (size_t i = 0; i < symbolList.size(); i++)
 	{
-		if ((symbolList[i] == ',') || (i == symbolList.length()))
-		{
-			changeToGlobal(symbol);
-			symbol = "";
-			i++;
-			continue;
-		}
-		symbol += symbolList[i];
+		changeToGlobal(symbolList[i]);
 	}
 }
 
-Assembler::SectionTable::SectionTable(int id, string name, unsigned int value)
+Assembler::SectionTable::SectionTable(int id, Atom name, unsigned int value)
 {
 	entry.id = id;
 	entry.name = name;
@@ -223,7 +209,7 @@ void Assembler::addSectionsToSectab()
 	map<string, unsigned int>::iterator it;
 	for (it = sectionLocationCounter.begin(); it != sectionLocationCounter.end(); it++)
 	{
-		SectionTable* newEntry = new SectionTable(id++, it->first, it->second);
+		SectionTable* newEntry = arena.create<SectionTable>(id++, StringInterner::intern(it->first), it->second);
 		if (sectab == nullptr) sectab = newEntry;
 		else lastEntrySectab->next = newEntry;
 		lastEntrySectab = newEntry;
@@ -239,22 +225,11 @@ void Assembler::printSectionTable(ostream& os)
 	{
 		os << left << setw(6) << setfill(' ') << cur->entry.id;
 		os << right << setfill('0') << setw(8) << hex << cur->entry.value << dec << "    ";
-		os << left << cur->entry.name << endl;
-	}
-}
-
-void Assembler::deleteSectionTable()
-{
-	SectionTable* cur;
-	while (sectab != nullptr)
-	{
-		cur = sectab;
-		sectab = sectab->next;
-		delete cur;
+		os << left << StringInterner::name(cur->entry.name) << endl;
 	}
 }
 
-Assembler::RelocationTable::RelocationTable(unsigned int offset, string type, string symbol, string section, int addend)
+Assembler::RelocationTable::RelocationTable(unsigned int offset, RelocationType type, Atom symbol, Atom section, int addend)
 {
 	entry.offset = offset;
 	entry.type = type;
@@ -265,50 +240,42 @@ Assembler::RelocationTable::RelocationTable(unsigned int offset, string type, st
 }
 
 
-void Assembler::addRecordToReltab(string symbol)
+void Assembler::addRecordToReltab(Atom symbol)
 {
-	SymbolTable* curSymbol = symtab;
-	while (curSymbol != nullptr)
-	{
-		if (curSymbol->entry.name == symbol) break;
-		curSymbol = curSymbol->next;
-	}
-	if (curSymbol == nullptr)
+	int position = findSymbol(symbol);
+	if (position == -1)
 	{
 		errorMessage("Error, line " + to_string(lineNum) + ": Symbol not in SymbolTable!\n");
 	}
+	SymbolTableEntry& curSymbol = symtab[position];
 
 	int addend = 0;
-	string type = "R_ABS_32";
-	string relSym = "";
-	if (curSymbol->entry.type == SECTION)
+	RelocationType type = R_ABS_32;
+	Atom relSym = 0;
+	if (curSymbol.type == SECTION)
 	{
 		addend = 0;
-		relSym = curSymbol->entry.name;
+		relSym = curSymbol.name;
 	}
 	else
 	{
-		SymbolTable* curSection = symtab;
-		while (curSection != nullptr)
-		{
-			if (curSection->entry.id == curSymbol->entry.sectionId) break;
-			curSection = curSection->next;
-		}
-		if (curSection == nullptr)
+		int sectionId = curSymbol.sectionId;
+		if ((sectionId < 0) || (sectionId >= (int)symtab.size()))
 		{
 			errorMessage("Error, line " + to_string(lineNum) + ": Section not in SymbolTable!\n");
 		}
-		SymbolBinding binding = curSymbol->entry.binding;
+		SymbolTableEntry& curSection = symtab[sectionId];
+		SymbolBinding binding = curSymbol.binding;
 		if (binding == LOCAL)
 		{
-			addend = curSymbol->entry.value;
-			relSym = curSection->entry.name;
-			type = "R_SEO_32";
+			addend = curSymbol.value;
+			relSym = curSection.name;
+			type = R_SEO_32;
 		}
 		else if ((binding == GLOBAL) || (binding == EXTERN))
 		{
 			addend = 0;
-			relSym = curSymbol->entry.name;
+			relSym = curSymbol.name;
 		}
 		else
 		{
@@ -316,15 +283,19 @@ void Assembler::addRecordToReltab(string symbol)
 		}
 	}
 
-	RelocationTable* newEntry = new RelocationTable(sectionLocationCounter[currentSection], type, relSym, currentSection, addend);
+	unsigned int offset = sectionLocationCounter[currentSection];
+	RelocationTable* newEntry = arena.create<RelocationTable>(offset, type, relSym, currentSectionName, addend);
 	if (reltab == nullptr) reltab = newEntry;
 	else lastEntryReltab->next = newEntry;
 	lastEntryReltab = newEntry;
 
-	stringstream ss;
-	ss << setw(8) << setfill('0') << hex << sectionLocationCounter[currentSection] << setw(0) << "     " << type << "     ";
-	ss << setw(15) << left << setfill(' ') << relSym << right << setfill('0') << setw(8) << addend << "     (" + symbol + ")\n";
-	sectionRelocationData[currentSection] += ss.str();
+	if (textOutput)
+	{
+		stringstream ss;
+		ss << setw(8) << setfill('0') << hex << offset << setw(0) << "     " << getRelocationTypeName(type) << "     ";
+		ss << setw(15) << left << setfill(' ') << StringInterner::name(relSym) << right << setfill('0') << setw(8) << addend << "     (" + StringInterner::name(symbol) + ")\n";
+		sectionRelocationData[currentSection] += ss.str();
+	}
 }
 
 void Assembler::printRelocationTable(ostream& os)
@@ -338,44 +309,21 @@ void Assembler::printRelocationTable(ostream& os)
 	}
 }
 
-void Assembler::deleteRelocationTable()
-{
-	RelocationTable* cur;
-	while (reltab != nullptr)
-	{
-		cur = reltab;
-		reltab = reltab->next;
-		delete cur;
-	}
-}
-
-int Assembler::countParamsInWord(string symbolsAndLiterals)
-{
-	int cnt = 1;
-	int len = symbolsAndLiterals.length();
-	for (int i = 0; i < len - 1; i++)
-	{
-		if (symbolsAndLiterals[i] == ',') cnt++;
-	}
-	return cnt;
-}
-
 unsigned int Assembler::getLiteralInSkip(string literal)
 {
 	int base = (literal[0] == '0') ? 16 : 10;
 	return stoul(literal, nullptr, base);
 }
 
-void Assembler::writeInstructionData(string code)
+void Assembler::writeWord(uint32_t word)
 {
-	if (code == "") return;
-	if (sectionData[currentSection] != "")
-	{
-		sectionData[currentSection] += "\n";
-	}
-	stringstream ss;
-	ss << setw(4) << setfill('0') << hex << sectionLocationCounter[currentSection];
-	sectionData[currentSection] += ss.str() + ": " + code;
+	vector<uint8_t>& data = sectionData[currentSection];
+	unsigned int offset = sectionLocationCounter[currentSection];
+	if (data.size() < offset + 4) data.resize(offset + 4, 0);
+	data[offset] = word & 0xFF;
+	data[offset + 1] = (word >> 8) & 0xFF;
+	data[offset + 2] = (word >> 16) & 0xFF;
+	data[offset + 3] = (word >> 24) & 0xFF;
 }
 
 int Assembler::getRegisterIndex(string reg)
@@ -411,22 +359,6 @@ int Assembler::getNumberFromLiteral(string num)
 	return 0;
 }
 
-char Assembler::getHexfromInt(int num)
-{
-	return int_to_hex[num];
-}
-
-string Assembler::formatHexData(string hexStr)
-{
-	hexStr = "00000000" + hexStr;
-	stringstream retStr;
-	for (size_t i = hexStr.length() - 1, k = 0; k < 4; i -= 2, k++)
-	{
-		retStr << hexStr[i - 1] << hexStr[i];
-	}
-	return retStr.str();
-}
-
 string Assembler::formatNumberToHex(int num)
 {
 	stringstream hexStr;
@@ -434,135 +366,111 @@ string Assembler::formatNumberToHex(int num)
 	return hexStr.str();
 }
 
-void Assembler::writeArithmeticLogicInstruction(string regs, string opcode)
+void Assembler::writeArithmeticLogicInstruction(Statement& statement)
 {
-	string sourceRegister = getFirstRegister(regs);
-	string destinationRegister = getSecondRegister(regs);
-	string code = opcode;
-	code += getHexfromInt(getRegisterIndex(destinationRegister));
-	code += getHexfromInt(getRegisterIndex(destinationRegister));
-	code += getHexfromInt(getRegisterIndex(sourceRegister));
-	code += "000";
-	writeInstructionData(code);
+	int source = getRegisterIndex(statement.parsed.reg1);
+	int destination = getRegisterIndex(statement.parsed.reg2);
+	uint32_t word = 0;
+	switch (statement.parsed.type)
+	{
+	case INSTRUCTION_ADD: word = encode<INSTRUCTION_ADD, MODE_REGISTER>(source, destination, 0); break;
+	case INSTRUCTION_SUB: word = encode<INSTRUCTION_SUB, MODE_REGISTER>(source, destination, 0); break;
+	case INSTRUCTION_MUL: word = encode<INSTRUCTION_MUL, MODE_REGISTER>(source, destination, 0); break;
+	case INSTRUCTION_DIV: word = encode<INSTRUCTION_DIV, MODE_REGISTER>(source, destination, 0); break;
+	case INSTRUCTION_AND: word = encode<INSTRUCTION_AND, MODE_REGISTER>(source, destination, 0); break;
+	case INSTRUCTION_OR:  word = encode<INSTRUCTION_OR,  MODE_REGISTER>(source, destination, 0); break;
+	case INSTRUCTION_XOR: word = encode<INSTRUCTION_XOR, MODE_REGISTER>(source, destination, 0); break;
+	case INSTRUCTION_SHL: word = encode<INSTRUCTION_SHL, MODE_REGISTER>(source, destination, 0); break;
+	case INSTRUCTION_SHR: word = encode<INSTRUCTION_SHR, MODE_REGISTER>(source, destination, 0); break;
+	default: break;
+	}
+	writeWord(word);
 }
 
-void Assembler::writeBranchInstruction(string instr, string regsAndOperand, int inc, string hexNum)
+void Assembler::writeBranchInstruction(Statement& statement)
 {
-	int instruction = 0;
-	if (instr == "beq") instruction = 1;
-	if (instr == "bne") instruction = 2;
-	if (instr == "bgt") instruction = 3;
-	string code = "3";
-	string gpr1 = getBranchFirstReg(regsAndOperand);
-	string gpr2 = getBranchSecondReg(regsAndOperand);
-	string operand = getBranchOperand(regsAndOperand);
-	if (isSymbol(operand))
-	{
-		code += getHexfromInt(8 + instruction);
-		code += getHexfromInt(getRegisterIndex("pc"));
-		code += getHexfromInt(getRegisterIndex(gpr1));
-		code += getHexfromInt(getRegisterIndex(gpr2));
-		code += "000";
-		writeInstructionData(code);
-		sectionLocationCounter[currentSection] += 4;
-		writeInstructionData("????????");
-		addRecordToReltab(operand);
-		sectionLocationCounter[currentSection] += 4;
-	}
-	else
-	{
-		if (inc == 4)
-		{
-			stringstream ss;
-			ss << setw(3) << setfill('0') << hexNum;
-
-			code += getHexfromInt(instruction);
-			code += "0";
-			code += getHexfromInt(getRegisterIndex(gpr1));
-			code += getHexfromInt(getRegisterIndex(gpr2));
-			code += ss.str();
-			writeInstructionData(code);
-			sectionLocationCounter[currentSection] += 4;
-		}
-		if (inc == 8)
-		{
-			code += getHexfromInt(8 + instruction);
-			code += getHexfromInt(getRegisterIndex("pc"));
-			code += getHexfromInt(getRegisterIndex(gpr1));
-			code += getHexfromInt(getRegisterIndex(gpr2));
-			code += "000";
-			writeInstructionData(code);
-			sectionLocationCounter[currentSection] += 4;
-			writeInstructionData(formatHexData(hexNum));
-			sectionLocationCounter[currentSection] += 4;
-		}
-	}
+	int gpr1 = getRegisterIndex(statement.parsed.reg1);
+	int gpr2 = getRegisterIndex(statement.parsed.reg2);
+	int disp = getOperandDisplacement(statement);
+	uint32_t word = 0;
+	if (statement.parsed.type == INSTRUCTION_BEQ) word = encode<INSTRUCTION_BEQ>(statement.mode, gpr1, gpr2, disp);
+	if (statement.parsed.type == INSTRUCTION_BNE) word = encode<INSTRUCTION_BNE>(statement.mode, gpr1, gpr2, disp);
+	if (statement.parsed.type == INSTRUCTION_BGT) word = encode<INSTRUCTION_BGT>(statement.mode, gpr1, gpr2, disp);
+	writeWord(word);
+	sectionLocationCounter[currentSection] += 4;
 }
 
-int Assembler::getOperandSize(string operand, string& hexNum)
+OperandMode Assembler::getOperandMode(string operand, OperandKind kind, unsigned int& literal)
 {
-	int increment = 0;
-	if (isSymbol(operand))
+	OperandMode mode = MODE_POOL;
+	if (kind == OPERAND_HEX)
 	{
-		increment = 8;
-	}
-	if (isHexLiteral(operand))
-	{
-		hexNum = operand.substr(2);
+		string hexNum = operand.substr(2);
 		checkIfHexIsValid(hexNum);
-		removeTrailingZeros(hexNum);
-		increment = hexNum.length() > 3 ? 8 : 4;
+		literal = stoul(hexNum, nullptr, 16);
+		mode = fitsInDisplacement(literal) ? MODE_INLINE : MODE_POOL;
 	}
-	if (isNumberLiteral(operand))
+	if (kind == OPERAND_NUMBER)
 	{
-		int num = getNumberFromLiteral(operand);
-		hexNum = formatNumberToHex(num);
-		increment = hexNum.length() > 3 ? 8 : 4;
+		literal = getNumberFromLiteral(operand);
+		mode = fitsInDisplacement(literal) ? MODE_INLINE : MODE_POOL;
 	}
-	return increment;
+	return mode;
 }
 
-void Assembler::pushRegister(string reg)
+bool Assembler::fitsInDisplacement(unsigned int literal)
 {
-	string code = "81";
-	code += getHexfromInt(getRegisterIndex("sp"));
-	code += "0";
-	code += getHexfromInt(getRegisterIndex(reg));
-	code += "FFC";
-	writeInstructionData(code);
+	// The processor sign-extends D, so only 0x000 - 0x7FF can be used inline
+	return literal <= 0x7FF;
 }
 
-void Assembler::popRegister(string reg)
+void Assembler::printSectionData(ostream& os)
 {
-	string code = "9";
-	if ((reg == "status") || (reg == "handler") || (reg == "cause"))
-	{
-		code += "7";
-	}
-	else
+	for (map<string, vector<uint8_t>>::iterator it = sectionData.begin(); it != sectionData.end(); it++)
 	{
-		code += "3";
+		os << "\n" + it->first + "\n" + getSectionListing(StringInterner::find(it->first)) + "\n";
 	}
-	code += getHexfromInt(getRegisterIndex(reg));
-	code += getHexfromInt(getRegisterIndex("sp"));
-	code += "0004";
-	writeInstructionData(code);
 }
 
-void Assembler::printSectionData(ostream& os)
+string Assembler::getSectionListing(Atom section)
 {
-	for (map<string, string>::iterator it = sectionData.begin(); it != sectionData.end(); it++)
+	// Four bytes per line, every relocated word on its own line as ????????
+	set<unsigned int> relocated;
+	for (RelocationTable* rel = reltab; rel != nullptr; rel = rel->next)
+	{
+		if (rel->entry.section == section) relocated.insert(rel->entry.offset);
+	}
+
+	vector<uint8_t>& data = sectionData[StringInterner::name(section)];
+	stringstream ss;
+	size_t offset = 0;
+	while (offset < data.size())
 	{
-		os << "\n" + it->first + "\n" + it->second + "\n";
+		if (offset != 0) ss << "\n";
+		ss << nouppercase << setw(4) << setfill('0') << hex << offset << ": " << uppercase;
+		if (relocated.count(offset))
+		{
+			ss << "????????";
+			offset += 4;
+			continue;
+		}
+		size_t end = min(offset + 4, data.size());
+		set<unsigned int>::iterator next = relocated.upper_bound(offset);
+		if ((next != relocated.end()) && (*next < end)) end = *next;
+		for (; offset < end; offset++)
+		{
+			ss << setw(2) << (int)data[offset];
+		}
 	}
+	return ss.str();
 }
 
-string Assembler::getLoadStoreHexDisplacement(string disp)
+int Assembler::getLoadStoreDisplacement(string disp, OperandKind kind)
 {
-	string hexNum;
-	if (isHexLiteral(disp))
+	int value = 0;
+	if (kind == OPERAND_HEX)
 	{
-		hexNum = disp.substr(2);
+		string hexNum = disp.substr(2);
 		checkIfHexIsValid(hexNum);
 		int len = hexNum.length();
 		for (int i = 0; i < (len - 3); i++)
@@ -572,26 +480,28 @@ string Assembler::getLoadStoreHexDisplacement(string disp)
 				errorMessage("Error, line " + to_string(lineNum) + ": Literal must be max 12-bits wide!\n");
 			}
 		}
+		value = stoul(hexNum, nullptr, 16);
+		if (!fitsInDisplacement(value))
+		{
+			errorMessage("Error, line " + to_string(lineNum) + ": Hex displacement above 0x7FF would be negative, D is sign-extended!\n");
+		}
 	}
-	if (isNumberLiteral(disp))
+	if (kind == OPERAND_NUMBER)
 	{
-		int num = getNumberFromLiteral(disp);
-		if ((num > 2047) || (num < -2048))
+		value = getNumberFromLiteral(disp);
+		if ((value > 2047) || (value < -2048))
 		{
 			errorMessage("Error, line " + to_string(lineNum) + ": Literal must be max 12-bits wide!\n");
 		}
-		hexNum = formatNumberToHex(num);
-	}
-
-	for (size_t i = hexNum.length(); i < 3; i++)
-	{
-		hexNum = "0" + hexNum;
 	}
-	return hexNum;
+	return value;
 }
 
 void Assembler::errorMessage(string msg)
 {
+	// Several assemblers may run in parallel, only the first error is reported
+	static mutex errorMutex;
+	errorMutex.lock();
 	cerr << msg << endl;
 	exit(1);
 }
@@ -614,16 +524,17 @@ void Assembler::checkIfHexIsValid(string hexNum)
 
 void Assembler::printSection(ostream& os)
 {
-	for (SymbolTable* cur = symtab; cur != nullptr; cur = cur->next)
+	for (size_t i = 0; i < symtab.size(); i++)
 	{
-		if (cur->entry.type == SECTION)
+		if (symtab[i].type == SECTION)
 		{
-			os << "\nRELOCATION_DATA: #" + cur->entry.name + "\n";
+			const string& name = StringInterner::name(symtab[i].name);
+			os << "\nRELOCATION_DATA: #" + name + "\n";
 			os << "OFFSET       TYPE         SYMBOL         ADDEND" << endl;
-			os << sectionRelocationData[cur->entry.name] << endl;
+			os << sectionRelocationData[name] << endl;
 
-			os << "SECTION_DATA: #" + cur->entry.name + "\n";
-			os << sectionData[cur->entry.name] + "\n";
+			os << "SECTION_DATA: #" + name + "\n";
+			os << getSectionListing(symtab[i].name) + "\n";
 		}
 	}
 }
@@ -631,34 +542,59 @@ void Assembler::printSection(ostream& os)
 
 void Assembler::preprocessing()
 {
-	string line;
-	stringstream ss;
 	ifstream inputFile(inputFileName);
 	if (inputFile.is_open())
 	{
-		ofstream tempfile(FORMATED_FILE);
-		if (tempfile.is_open())
+		vector<Statement> body;
+		string line;
+		unsigned int sourceLine = 0;
+		while (getline(inputFile, line))
 		{
-			while (getline(inputFile, line))
+			sourceLine++;
+			formatLine(line);
+			if (line.length() == 0) continue;
+
+			// Labels are placed in front of the rest of the line by formatLine
+			bool multipleStatements = (line.find('\n') != string::npos);
+			size_t begin = 0;
+			while (begin <= line.length())
 			{
-				formatLine(line);
-				if (isDirectiveGlobal(line) || isDirectiveExtern(line))
+				size_t end = line.find('\n', begin);
+				if (end == string::npos) end = line.length();
+				string part = line.substr(begin, end - begin);
+				begin = end + 1;
+				if (part.length() == 0) continue;
+
+				Statement statement;
+				statement.lineNum = sourceLine;
+				if (!parseLine(part, statement.parsed))
+				{
+					statement.parsed.type = LINE_UNKNOWN;
+					statement.parsed.operand = part;
+				}
+
+				// Names are interned once here, the passes only compare atoms
+				ParsedLine& parsed = statement.parsed;
+				if (parsed.operandKind == OPERAND_SYMBOL) statement.name = StringInterner::intern(parsed.operand);
+				statement.paramNames.resize(parsed.params.size(), 0);
+				for (size_t i = 0; i < parsed.params.size(); i++)
 				{
-					tempfile << line + '\n';
+					if (parsed.paramKinds[i] == OPERAND_SYMBOL) statement.paramNames[i] = StringInterner::intern(parsed.params[i]);
+				}
+
+				LineType type = statement.parsed.type;
+				if (!multipleStatements && ((type == DIRECTIVE_GLOBAL) || (type == DIRECTIVE_EXTERN)))
+				{
+					statements.push_back(statement);
 				}
 				else
 				{
-					ss << line + '\n';
+					body.push_back(statement);
 				}
 			}
-			tempfile << ss.str() + '\n';
-			inputFile.close();
-			tempfile.close();
-		}
-		else
-		{
-			errorMessage("Error opening file 'temp.s'");
 		}
+		statements.insert(statements.end(), body.begin(), body.end());
+		inputFile.close();
 	}
 	else
 	{
@@ -668,1032 +604,826 @@ void Assembler::preprocessing()
 
 void Assembler::assemblerPass(int pass)
 {
-	ifstream file(FORMATED_FILE);
-	if (file.is_open())
+	lineNum = 0;
+	bool endFound = false;
+	for (size_t i = 0; (i < statements.size()) && !endFound; i++)
 	{
-		line = "";
-		lineNum = 0;
-		while (getline(file, line))
-		{
-			lineNum++;
-			if (line.length() == 0) continue;
+		Statement& statement = statements[i];
+		ParsedLine& parsed = statement.parsed;
+		lineNum = statement.lineNum;
 
-			/*
-			DIRECTIVES
-			*/
+		string statementSection = currentSection;
+		map<string, unsigned int>::iterator counterBefore = sectionLocationCounter.find(currentSection);
+		unsigned int statementOffset = (counterBefore != sectionLocationCounter.end()) ? counterBefore->second : 0;
 
-			if (isDirectiveGlobal(line))
+		switch (parsed.type)
+		{
+		/*
+		DIRECTIVES
+		*/
+
+		case DIRECTIVE_GLOBAL:
+		{
+			if (pass == SECOND)
 			{
-				if (pass == FIRST)
-				{
-				}
-				if (pass == SECOND)
-				{
-					string symbolsGlobal = line.substr(8);
-					setSymbolsToGlobal(symbolsGlobal);
-				}
-				continue;
+				setSymbolsToGlobal(statement.paramNames);
 			}
-			if (isDirectiveExtern(line))
+			break;
+		}
+		case DIRECTIVE_EXTERN:
+		{
+			if (pass == SECOND)
 			{
-				if (pass == FIRST)
-				{
-				}
-				if (pass == SECOND)
-				{
-					string symbolsExtern = line.substr(8);
-					addExternSymbolsToSymtab(symbolsExtern);
-				}
-				continue;
+				addExternSymbolsToSymtab(statement.paramNames);
 			}
-			if (isDirectiveSection(line))
+			break;
+		}
+		case DIRECTIVE_SECTION:
+		{
+			if (pass == FIRST)
 			{
-				string section = line.substr(9);
-
-				if (pass == FIRST)
-				{
-					addNewSectionToSymtab(section);
-				}
-				if (pass == SECOND)
-				{
-					currentSection = section;
-				}
-				continue;
+				addNewSectionToSymtab(statement.name);
 			}
-			if (isDirectiveWord(line))
+			if (pass == SECOND)
 			{
-				string symbolsAndLiterals = line.substr(6);
-
-				if (pass == FIRST)
-				{
-					int count = countParamsInWord(symbolsAndLiterals);
-					sectionLocationCounter[currentSection] += 4 * count;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string param = "";
-					for (int i = 0; i <= symbolsAndLiterals.length(); i++)
-					{
-						if ((symbolsAndLiterals[i] == ',') || (i == symbolsAndLiterals.length()))
-						{
-							if (isSymbol(param))
-							{
-								writeInstructionData("????????");
-								addRecordToReltab(param);
-								sectionLocationCounter[currentSection] += 4;
-							}
-							if (isHexLiteral(param))
-							{
-								string hexNum = param.substr(2);
-								checkIfHexIsValid(hexNum);
-								writeInstructionData(formatHexData(hexNum));
-								sectionLocationCounter[currentSection] += 4;
-							}
-							if (isNumberLiteral(param))
-							{
-								int num = getNumberFromLiteral(param);
-								writeInstructionData(formatHexData(formatNumberToHex(num)));
-								sectionLocationCounter[currentSection] += 4;
-							}
-
-							param = "";
-							i++;
-							continue;
-						}
-						param += symbolsAndLiterals[i];
-					}
-				}
-				continue;
+				currentSection = parsed.operand;
+				currentSectionName = statement.name;
+			}
+			break;
+		}
+		case DIRECTIVE_WORD:
+		{
+			if (pass == FIRST)
+			{
+				sectionLocationCounter[currentSection] += 4 * parsed.params.size();
 			}
-			if (isDirectiveSkip(line))
+			if (pass == SECOND)
 			{
-				string literal = line.substr(6);
-				unsigned int num = getLiteralInSkip(literal);
-
-				if (pass == FIRST)
+				//writeInstructionData(line);
+				for (size_t i = 0; i < parsed.params.size(); i++)
 				{
-					sectionLocationCounter[currentSection] += num;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string code = "";
-					for (unsigned int i = 0; i < num; i++)
+					string param = parsed.params[i];
+					OperandKind kind = parsed.paramKinds[i];
+					if (kind == OPERAND_SYMBOL)
+					{
+						writeWord(0);
+						addRecordToReltab(statement.paramNames[i]);
+						sectionLocationCounter[currentSection] += 4;
+					}
+					if (kind == OPERAND_HEX)
+					{
+						string hexNum = param.substr(2);
+						checkIfHexIsValid(hexNum);
+						writeWord(stoul(hexNum, nullptr, 16));
+						sectionLocationCounter[currentSection] += 4;
+					}
+					if (kind == OPERAND_NUMBER)
 					{
-						if (i != 0 && i % 4 == 0)
-						{
-							writeInstructionData(code);
-							sectionLocationCounter[currentSection] += 4;
-							code = "";
-						}
-						code += "00";
+						int num = getNumberFromLiteral(param);
+						writeWord(num);
+						sectionLocationCounter[currentSection] += 4;
 					}
-					writeInstructionData(code);
-					int len = code.length();
-					sectionLocationCounter[currentSection] += len / 2;
 				}
-				continue;
 			}
-			if (isDirectiveEnd(line))
+			break;
+		}
+		case DIRECTIVE_SKIP:
+		{
+			unsigned int num = getLiteralInSkip(parsed.operand);
+
+			if (pass == FIRST)
+			{
+				sectionLocationCounter[currentSection] += num;
+			}
+			if (pass == SECOND)
 			{
-				if (pass == FIRST)
-				{
-				}
-				if (pass == SECOND)
-				{
-				}
-				break;
+				//writeInstructionData(line);
+				vector<uint8_t>& data = sectionData[currentSection];
+				data.resize(sectionLocationCounter[currentSection] + num, 0);
+				sectionLocationCounter[currentSection] += num;
 			}
+			break;
+		}
+		case DIRECTIVE_END:
+		{
+			endFound = true;
+			break;
+		}
+		case DIRECTIVE_LTORG:
+		{
+			// The pool itself is placed by layoutSections
+			break;
+		}
 
-			/*
-			INSTRUCTIONS
-			*/
+		/*
+		INSTRUCTIONS
+		*/
 
-			// HALT INSTRUCTION
-			if (isInstructionHalt(line))
+		// HALT INSTRUCTION
+		case INSTRUCTION_HALT:
+		{
+			if (pass == FIRST)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					writeInstructionData("00000000");
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
+			}
+			if (pass == SECOND)
+			{
+				//writeInstructionData(line);
+				writeWord(encode<INSTRUCTION_HALT, MODE_REGISTER>(0, 0, 0));
+				sectionLocationCounter[currentSection] += 4;
 			}
+			break;
+		}
 
-			// INTERRUPT CALLS
-			if (isInstructionInt(line))
+		// INTERRUPT CALLS
+		case INSTRUCTION_INT:
+		{
+			if (pass == FIRST)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					writeInstructionData("10000000");
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
 			}
-			if (isInstructionIret(line))
+			if (pass == SECOND)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 8;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string code = "93";
-					code += getHexfromInt(getRegisterIndex("pc"));
-					code += getHexfromInt(getRegisterIndex("sp"));
-					code += "1004";
-					writeInstructionData(code);
-					sectionLocationCounter[currentSection] += 4;
-					popRegister("status");
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				//writeInstructionData(line);
+				writeWord(encode<INSTRUCTION_INT, MODE_REGISTER>(0, 0, 0));
+				sectionLocationCounter[currentSection] += 4;
 			}
-
-			// FUNCTION CALLS
-			if (isInstructionCall(line))
+			break;
+		}
+		case INSTRUCTION_IRET:
+		{
+			if (pass == FIRST)
 			{
-				string operand = line.substr(5);
-				string hexNum;
-				int increment = getOperandSize(operand, hexNum);
-
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += increment;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					if (isSymbol(operand))
-					{
-						string code = "21";
-						code += getHexfromInt(getRegisterIndex("pc"));
-						code += "00000";
-						writeInstructionData(code);
-						sectionLocationCounter[currentSection] += 4;
-						writeInstructionData("????????");
-						addRecordToReltab(operand);
-						sectionLocationCounter[currentSection] += 4;
-					}
-					else
-					{
-						if (increment == 4)
-						{
-							stringstream ss;
-							ss << setw(3) << setfill('0') << hexNum;
-							string code = "20000";
-							code += ss.str();
-							writeInstructionData(code);
-							sectionLocationCounter[currentSection] += 4;
-						}
-						if (increment == 8)
-						{
-							string code = "21";
-							code += getHexfromInt(getRegisterIndex("pc"));
-							code += "00000";
-							writeInstructionData(code);
-							sectionLocationCounter[currentSection] += 4;
-							writeInstructionData(formatHexData(hexNum));
-							sectionLocationCounter[currentSection] += 4;
-						}
-					}
-				}
-				continue;
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
 			}
-			if (isInstructionRet(line))
+			if (pass == SECOND)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					popRegister("pc");
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				//writeInstructionData(line);
+				writeWord(encode<INSTRUCTION_IRET, MODE_REGISTER>(0, 0, 0));
+				sectionLocationCounter[currentSection] += 4;
+				writeWord(encode<INSTRUCTION_IRET, MODE_SECOND_WORD>(0, 0, 0));
+				sectionLocationCounter[currentSection] += 4;
 			}
+			break;
+		}
 
-			// JUMP/COMPARE INSTRUCTIONS
-			if (isInstructionJmp(line))
+		// FUNCTION CALLS
+		case INSTRUCTION_CALL:
+		{
+			if (pass == FIRST)
 			{
-				string operand = line.substr(4);
-				string hexNum;
-				int increment = getOperandSize(operand, hexNum);
-
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += increment;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					if (isSymbol(operand))
-					{
-						string code = "38";
-						code += getHexfromInt(getRegisterIndex("pc"));
-						code += "00000";
-						writeInstructionData(code);
-						sectionLocationCounter[currentSection] += 4;
-						writeInstructionData("????????");
-						addRecordToReltab(operand);
-						sectionLocationCounter[currentSection] += 4;
-					}
-					else
-					{
-						if (increment == 4)
-						{
-							stringstream ss;
-							ss << setw(3) << setfill('0') << hexNum;
-							string code = "30000";
-							code += ss.str();
-							writeInstructionData(code);
-							sectionLocationCounter[currentSection] += 4;
-						}
-						if (increment == 8)
-						{
-							string code = "38";
-							code += getHexfromInt(getRegisterIndex("pc"));
-							code += "00000";
-							writeInstructionData(code);
-							sectionLocationCounter[currentSection] += 4;
-							writeInstructionData(formatHexData(hexNum));
-							sectionLocationCounter[currentSection] += 4;
-						}
-					}
-				}
-				continue;
+				statement.mode = getOperandMode(parsed.operand, parsed.operandKind, statement.literal);
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
 			}
-			if (isInstructionBeq(line))
+			if (pass == SECOND)
 			{
-				string regsAndOperand = line.substr(4);
-				string operand = getBranchOperand(regsAndOperand);
-				string hexNum;
-				int increment = getOperandSize(operand, hexNum);
-
-				if (pass == FIRST)
-				{
-
-					sectionLocationCounter[currentSection] += increment;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					writeBranchInstruction("beq", regsAndOperand, increment, hexNum);
-				}
-				continue;
+				//writeInstructionData(line);
+				writeWord(encode<INSTRUCTION_CALL>(statement.mode, 0, 0, getOperandDisplacement(statement)));
+				sectionLocationCounter[currentSection] += 4;
 			}
-			if (isInstructionBne(line))
+			break;
+		}
+		case INSTRUCTION_RET:
+		{
+			if (pass == FIRST)
 			{
-				string regsAndOperand = line.substr(4);
-				string operand = getBranchOperand(regsAndOperand);
-				string hexNum;
-				int increment = getOperandSize(operand, hexNum);
-
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += increment;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					writeBranchInstruction("bne", regsAndOperand, increment, hexNum);
-				}
-				continue;
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
 			}
-			if (isInstructionBgt(line))
+			if (pass == SECOND)
 			{
-				string regsAndOperand = line.substr(4);
-				string operand = getBranchOperand(regsAndOperand);
-				string hexNum;
-				int increment = getOperandSize(operand, hexNum);
-
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += increment;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					writeBranchInstruction("bgt", regsAndOperand, increment, hexNum);
-				}
-				continue;
+				//writeInstructionData(line);
+				writeWord(encode<INSTRUCTION_RET, MODE_REGISTER>(0, 0, 0));
+				sectionLocationCounter[currentSection] += 4;
 			}
+			break;
+		}
 
-			// STACK INSTRUCTIONS
-			if (isInstructionPush(line))
+		// JUMP/COMPARE INSTRUCTIONS
+		case INSTRUCTION_JMP:
+		{
+			if (pass == FIRST)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string reg = line.substr(6);
-					pushRegister(reg);
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				statement.mode = getOperandMode(parsed.operand, parsed.operandKind, statement.literal);
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
 			}
-			if (isInstructionPop(line))
+			if (pass == SECOND)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string reg = line.substr(5);
-					popRegister(reg);
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				//writeInstructionData(line);
+				writeWord(encode<INSTRUCTION_JMP>(statement.mode, 0, 0, getOperandDisplacement(statement)));
+				sectionLocationCounter[currentSection] += 4;
 			}
-
-			// EXCHANGE INSTUCTION
-			if (isInstructionExchange(line))
+			break;
+		}
+		case INSTRUCTION_BEQ:
+		case INSTRUCTION_BNE:
+		case INSTRUCTION_BGT:
+		{
+			if (pass == FIRST)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string regs = line.substr(5);
-					string sourceRegister = getFirstRegister(regs);
-					string destinationRegister = getSecondRegister(regs);
-					string code = "400";
-					code += getHexfromInt(getRegisterIndex(destinationRegister));
-					code += getHexfromInt(getRegisterIndex(sourceRegister));
-					code += "000";
-					writeInstructionData(code);
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				statement.mode = getOperandMode(parsed.operand, parsed.operandKind, statement.literal);
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
+			}
+			if (pass == SECOND)
+			{
+				//writeInstructionData(line);
+				writeBranchInstruction(statement);
 			}
+			break;
+		}
 
-			// ARITHMETIC INSTRUCTIONS
-			if (isInstructionAdd(line))
+		// STACK INSTRUCTIONS
+		case INSTRUCTION_PUSH:
+		{
+			if (pass == FIRST)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string regs = line.substr(4);
-					string code = "50";
-					writeArithmeticLogicInstruction(regs, code);
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
 			}
-			if (isInstructionSub(line))
+			if (pass == SECOND)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string regs = line.substr(4);
-					string code = "51";
-					writeArithmeticLogicInstruction(regs, code);
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				//writeInstructionData(line);
+				writeWord(encode<INSTRUCTION_PUSH, MODE_REGISTER>(getRegisterIndex(parsed.reg1), 0, 0));
+				sectionLocationCounter[currentSection] += 4;
 			}
-			if (isInstructionMul(line))
+			break;
+		}
+		case INSTRUCTION_POP:
+		{
+			if (pass == FIRST)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string regs = line.substr(4);
-					string code = "52";
-					writeArithmeticLogicInstruction(regs, code);
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
 			}
-			if (isInstructionDiv(line))
+			if (pass == SECOND)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string regs = line.substr(4);
-					string code = "53";
-					writeArithmeticLogicInstruction(regs, code);
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				//writeInstructionData(line);
+				writeWord(encode<INSTRUCTION_POP, MODE_REGISTER>(getRegisterIndex(parsed.reg1), 0, 0));
+				sectionLocationCounter[currentSection] += 4;
 			}
+			break;
+		}
 
-			// LOGIC INSTRUCITONS
-			if (isInstructionNot(line))
+		// EXCHANGE INSTUCTION
+		case INSTRUCTION_XCHG:
+		{
+			if (pass == FIRST)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string reg = line.substr(4);
-					string singleRegister = getFirstRegister(reg);
-					string code = "60";
-					code += getHexfromInt(getRegisterIndex(singleRegister));
-					code += getHexfromInt(getRegisterIndex(singleRegister));
-					code += "0000";
-					writeInstructionData(code);
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
 			}
-			if (isInstructionAnd(line))
+			if (pass == SECOND)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string regs = line.substr(4);
-					string code = "61";
-					writeArithmeticLogicInstruction(regs, code);
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				//writeInstructionData(line);
+				string sourceRegister = parsed.reg1;
+				string destinationRegister = parsed.reg2;
+				writeWord(encode<INSTRUCTION_XCHG, MODE_REGISTER>(getRegisterIndex(sourceRegister), getRegisterIndex(destinationRegister), 0));
+				sectionLocationCounter[currentSection] += 4;
 			}
-			if (isInstructionOr(line))
+			break;
+		}
+
+		// ARITHMETIC, LOGIC AND SHIFT INSTRUCTIONS
+		case INSTRUCTION_ADD:
+		case INSTRUCTION_SUB:
+		case INSTRUCTION_MUL:
+		case INSTRUCTION_DIV:
+		case INSTRUCTION_AND:
+		case INSTRUCTION_OR:
+		case INSTRUCTION_XOR:
+		case INSTRUCTION_SHL:
+		case INSTRUCTION_SHR:
+		{
+			if (pass == FIRST)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string regs = line.substr(3);
-					string code = "62";
-					writeArithmeticLogicInstruction(regs, code);
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
 			}
-			if (isInstructionXor(line))
+			if (pass == SECOND)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string regs = line.substr(4);
-					string code = "63";
-					writeArithmeticLogicInstruction(regs, code);
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				//writeInstructionData(line);
+				writeArithmeticLogicInstruction(statement);
+				sectionLocationCounter[currentSection] += 4;
+			}
+			break;
+		}
+		case INSTRUCTION_NOT:
+		{
+			if (pass == FIRST)
+			{
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
 			}
+			if (pass == SECOND)
+			{
+				//writeInstructionData(line);
+				string singleRegister = parsed.reg1;
+				writeWord(encode<INSTRUCTION_NOT, MODE_REGISTER>(getRegisterIndex(singleRegister), 0, 0));
+				sectionLocationCounter[currentSection] += 4;
+			}
+			break;
+		}
 
-			// SHIFT INSTRUCTIONS
-			if (isInstructionShl(line))
+		// LOAD INSTRUCTIONS
+		case INSTRUCTION_LOAD_IMMED:
+		{
+			if (pass == FIRST)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string regs = line.substr(4);
-					string code = "70";
-					writeArithmeticLogicInstruction(regs, code);
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				statement.mode = getOperandMode(parsed.operand, parsed.operandKind, statement.literal);
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
 			}
-			if (isInstructionShr(line))
+			if (pass == SECOND)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
+				//writeInstructionData(line);
+				int gpr = getRegisterIndex(parsed.reg2);
+				writeWord(encode<INSTRUCTION_LOAD_IMMED>(statement.mode, 0, gpr, getOperandDisplacement(statement)));
+				sectionLocationCounter[currentSection] += 4;
+			}
+			break;
+		}
+		case INSTRUCTION_LOAD_MEMDIR:
+		{
+			if (pass == FIRST)
+			{
+				// Literal pool load of the address followed by the load from memory
+				statement.mode = getOperandMode(parsed.operand, parsed.operandKind, statement.literal);
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
+			}
+			if (pass == SECOND)
+			{
+				//writeInstructionData(line);
+				int gpr = getRegisterIndex(parsed.reg2);
+				writeWord(encode<INSTRUCTION_LOAD_MEMDIR>(statement.mode, 0, gpr, getOperandDisplacement(statement)));
+				sectionLocationCounter[currentSection] += 4;
+				if (statement.mode == MODE_POOL)
 				{
-					//writeInstructionData(line);
-					string regs = line.substr(4);
-					string code = "71";
-					writeArithmeticLogicInstruction(regs, code);
+					writeWord(encode<INSTRUCTION_LOAD_MEMDIR, MODE_SECOND_WORD>(0, gpr, 0));
 					sectionLocationCounter[currentSection] += 4;
 				}
-				continue;
 			}
+			break;
+		}
+		case INSTRUCTION_LOAD_REGDIR:
+		{
+			if (pass == FIRST)
+			{
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
+			}
+			if (pass == SECOND)
+			{
+				//writeInstructionData(line);
+				string gpr = parsed.reg2;
+				string operand = parsed.reg1;
+				checkIfRegisterIsValid(operand);
 
-			// LOAD INSTRUCTIONS
-			if (isInstructionLoadImmed(line))
+				writeWord(encode<INSTRUCTION_LOAD_REGDIR, MODE_REGISTER>(getRegisterIndex(operand), getRegisterIndex(gpr), 0));
+				sectionLocationCounter[currentSection] += 4;
+			}
+			break;
+		}
+		case INSTRUCTION_LOAD_REGIND:
+		{
+			if (pass == FIRST)
+			{
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
+			}
+			if (pass == SECOND)
 			{
-				string operandAndReg = line.substr(3);
-				string operand = getLoadOperand(operandAndReg).substr(1);
-				string hexNum;
-				int increment = getOperandSize(operand, hexNum);
+				//writeInstructionData(line);
+				string gpr = parsed.reg2;
+				string operand = parsed.reg1;
+				checkIfRegisterIsValid(operand);
 
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += increment;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string gpr = getLoadRegister(operandAndReg);
-					if (isSymbol(operand))
-					{
-						string code = "92";
-						code += getHexfromInt(getRegisterIndex(gpr));
-						code += getHexfromInt(getRegisterIndex("pc"));
-						code += "1000";
-						writeInstructionData(code);
-						sectionLocationCounter[currentSection] += 4;
-						writeInstructionData("????????");
-						addRecordToReltab(operand);
-						sectionLocationCounter[currentSection] += 4;
-					}
-					else
-					{
-						if (increment == 4)
-						{
-							stringstream ss;
-							ss << setw(3) << setfill('0') << hexNum;
-
-							string code = "91";
-							code += getHexfromInt(getRegisterIndex(gpr));
-							code += "00";
-							code += ss.str();
-							writeInstructionData(code);
-							sectionLocationCounter[currentSection] += 4;
-						}
-						if (increment == 8)
-						{
-							string code = "92";
-							code += getHexfromInt(getRegisterIndex(gpr));
-							code += getHexfromInt(getRegisterIndex("pc"));
-							code += "1000";
-							writeInstructionData(code);
-							sectionLocationCounter[currentSection] += 4;
-							writeInstructionData(formatHexData(hexNum));
-							sectionLocationCounter[currentSection] += 4;
-						}
-					}
-				}
-				continue;
+				writeWord(encode<INSTRUCTION_LOAD_REGIND, MODE_REGISTER>(getRegisterIndex(operand), getRegisterIndex(gpr), 0));
+				sectionLocationCounter[currentSection] += 4;
 			}
-			if (isInstructionLoadMemDir(line))
+			break;
+		}
+		case INSTRUCTION_LOAD_REGINDDISP:
+		{
+			if (pass == FIRST)
+			{
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
+			}
+			if (pass == SECOND)
 			{
-				string operandAndReg = line.substr(3);
-				string operand = getLoadOperand(operandAndReg);
-				string hexNum;
-				int increment = getOperandSize(operand, hexNum);
+				//writeInstructionData(line);
+				string gpr = parsed.reg2;
+				string reg = parsed.reg1;
+				string disp = parsed.operand;
+				checkIfRegisterIsValid(reg);
 
-				if (pass == FIRST)
-				{
-					int inc = (increment == 8) ? 4 : 0;
-					sectionLocationCounter[currentSection] += increment + inc;
-				}
-				if (pass == SECOND)
+				if (parsed.operandKind == OPERAND_SYMBOL)
 				{
-					//writeInstructionData(line);
-					string gpr = getLoadRegister(operandAndReg);
-					if (isSymbol(operand))
-					{
-						string code = "92";
-						code += getHexfromInt(getRegisterIndex(gpr));
-						code += getHexfromInt(getRegisterIndex("pc"));
-						code += "1000";
-						writeInstructionData(code);
-						sectionLocationCounter[currentSection] += 4;
-						writeInstructionData("????????");
-						addRecordToReltab(operand);
-						sectionLocationCounter[currentSection] += 4;
-						code = "92";
-						code += getHexfromInt(getRegisterIndex(gpr));
-						code += getHexfromInt(getRegisterIndex(gpr));
-						code += "0000";
-						writeInstructionData(code);
-						sectionLocationCounter[currentSection] += 4;
-					}
-					else
-					{
-						if (increment == 4)
-						{
-							stringstream ss;
-							ss << setw(3) << setfill('0') << hexNum;
-
-							string code = "92";
-							code += getHexfromInt(getRegisterIndex(gpr));
-							code += "00";
-							code += ss.str();
-							writeInstructionData(code);
-							sectionLocationCounter[currentSection] += 4;
-						}
-						if (increment == 8)
-						{
-							string code = "92";
-							code += getHexfromInt(getRegisterIndex(gpr));
-							code += getHexfromInt(getRegisterIndex("pc"));
-							code += "1000";
-							writeInstructionData(code);
-							sectionLocationCounter[currentSection] += 4;
-							writeInstructionData(formatHexData(hexNum));
-							sectionLocationCounter[currentSection] += 4;
-							code = "92";
-							code += getHexfromInt(getRegisterIndex(gpr));
-							code += getHexfromInt(getRegisterIndex(gpr));
-							code += "0000";
-							writeInstructionData(code);
-							sectionLocationCounter[currentSection] += 4;
-						}
-					}
+					errorMessage("Error, line " + to_string(lineNum) + ": Symbol value must be defined during assembling!");
 				}
-				continue;
+				int displacement = getLoadStoreDisplacement(disp, parsed.operandKind);
+				writeWord(encode<INSTRUCTION_LOAD_REGINDDISP, MODE_REGISTER>(getRegisterIndex(reg), getRegisterIndex(gpr), displacement));
+				sectionLocationCounter[currentSection] += 4;
 			}
-			if (isInstructionLoadRegDir(line))
+			break;
+		}
+
+		// STORE INSTRUCTIONS
+		case INSTRUCTION_STORE_IMMED:
+		{
+			errorMessage("Error, line " + to_string(lineNum) + ": Can not store register in immediate operand!");
+			break;
+		}
+		case INSTRUCTION_STORE_MEMDIR:
+		{
+			if (pass == FIRST)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string operandAndReg = line.substr(3);
-					string gpr = getLoadRegister(operandAndReg);
-					string operand = getLoadOperand(operandAndReg).substr(1);
-					checkIfRegisterIsValid(operand);
-
-					string code = "91";
-					code += getHexfromInt(getRegisterIndex(gpr));
-					code += getHexfromInt(getRegisterIndex(operand));
-					code += "0000";
-					writeInstructionData(code);
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				statement.mode = getOperandMode(parsed.operand, parsed.operandKind, statement.literal);
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
 			}
-			if (isInstructionLoadRegInd(line))
+			if (pass == SECOND)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string operandAndReg = line.substr(3);
-					string gpr = getLoadRegister(operandAndReg);
-					string operand = getLoadOperand(operandAndReg);
-					int len = operand.length();
-					operand = operand.substr(2, len - 3);
-					checkIfRegisterIsValid(operand);
-
-					string code = "92";
-					code += getHexfromInt(getRegisterIndex(gpr));
-					code += getHexfromInt(getRegisterIndex(operand));
-					code += "0000";
-					writeInstructionData(code);
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				//writeInstructionData(line);
+				int gpr = getRegisterIndex(parsed.reg1);
+				writeWord(encode<INSTRUCTION_STORE_MEMDIR>(statement.mode, gpr, 0, getOperandDisplacement(statement)));
+				sectionLocationCounter[currentSection] += 4;
 			}
-			if (isInstructionLoadRegIndDisp(line))
+			break;
+		}
+		case INSTRUCTION_STORE_REGDIR:
+		{
+			if (pass == FIRST)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string operandAndReg = line.substr(3);
-					string gpr = getLoadRegister(operandAndReg);
-					string reg = getIndDispRegister(getLoadOperand(operandAndReg));
-					string disp = getIndDispSymOrLit(getLoadOperand(operandAndReg));
-					checkIfRegisterIsValid(reg);
-
-					string hexNum;
-					string code = "92";
-					code += getHexfromInt(getRegisterIndex(gpr));
-					code += getHexfromInt(getRegisterIndex(reg));
-					code += "0";
-					if (isSymbol(disp))
-					{
-						errorMessage("Error, line " + to_string(lineNum) + ": Symbol value must be defined during assembling!");
-					}
-					else
-					{
-						hexNum = getLoadStoreHexDisplacement(disp);
-					}
-					code += hexNum;
-					writeInstructionData(code);
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
 			}
+			if (pass == SECOND)
+			{
+				//writeInstructionData(line);
+				string gpr = parsed.reg1;
+				string operand = parsed.reg2;
+				checkIfRegisterIsValid(operand);
 
-			// STORE INSTRUCTIONS
-			if (isInstructionStoreImmed(line))
+				writeWord(encode<INSTRUCTION_STORE_REGDIR, MODE_REGISTER>(getRegisterIndex(gpr), getRegisterIndex(operand), 0));
+				sectionLocationCounter[currentSection] += 4;
+			}
+			break;
+		}
+		case INSTRUCTION_STORE_REGIND:
+		{
+			if (pass == FIRST)
 			{
-				errorMessage("Error, line " + to_string(lineNum) + ": Can not store register in immediate operand!");
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
 			}
-			if (isInstructionStoreMemDir(line))
+			if (pass == SECOND)
 			{
-				string operandAndReg = line.substr(3);
-				string operand = getStoreOperand(operandAndReg);
-				string hexNum;
-				int increment = getOperandSize(operand, hexNum);
+				//writeInstructionData(line);
+				string gpr = parsed.reg1;
+				string operand = parsed.reg2;
+				checkIfRegisterIsValid(operand);
 
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += increment;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string gpr = getStoreRegister(operandAndReg);
-					if (isSymbol(operand))
-					{
-						string code = "82";
-						code += getHexfromInt(getRegisterIndex("pc"));
-						code += "0";
-						code += getHexfromInt(getRegisterIndex(gpr));
-						code += "000";
-						writeInstructionData(code);
-						sectionLocationCounter[currentSection] += 4;
-						writeInstructionData("????????");
-						addRecordToReltab(operand);
-						sectionLocationCounter[currentSection] += 4;
-					}
-					else
-					{
-						if (increment == 4)
-						{
-							stringstream ss;
-							ss << setw(3) << setfill('0') << hexNum;
-
-							string code = "8000";
-							code += getHexfromInt(getRegisterIndex(gpr));
-							code += ss.str();
-							writeInstructionData(code);
-							sectionLocationCounter[currentSection] += 4;
-						}
-						if (increment == 8)
-						{
-							string code = "82";
-							code += getHexfromInt(getRegisterIndex("pc"));
-							code += "0";
-							code += getHexfromInt(getRegisterIndex(gpr));
-							code += "000";
-							writeInstructionData(code);
-							sectionLocationCounter[currentSection] += 4;
-							writeInstructionData(formatHexData(hexNum));
-							sectionLocationCounter[currentSection] += 4;
-						}
-					}
-				}
-				continue;
+				writeWord(encode<INSTRUCTION_STORE_REGIND, MODE_REGISTER>(getRegisterIndex(gpr), getRegisterIndex(operand), 0));
+				sectionLocationCounter[currentSection] += 4;
 			}
-			if (isInstructionStoreRegDir(line))
+			break;
+		}
+		case INSTRUCTION_STORE_REGINDDISP:
+		{
+			if (pass == FIRST)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string operandAndReg = line.substr(3);
-					string gpr = getStoreRegister(operandAndReg);
-					string operand = getStoreOperand(operandAndReg).substr(1);
-					checkIfRegisterIsValid(operand);
-
-					string code = "91";
-					code += getHexfromInt(getRegisterIndex(operand));
-					code += getHexfromInt(getRegisterIndex(gpr));
-					code += "0000";
-					writeInstructionData(code);
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
 			}
-			if (isInstructionStoreRegInd(line))
+			if (pass == SECOND)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
+				//writeInstructionData(line);
+				string gpr = parsed.reg1;
+				string reg = parsed.reg2;
+				string disp = parsed.operand;
+				checkIfRegisterIsValid(reg);
+
+				if (parsed.operandKind == OPERAND_SYMBOL)
 				{
-					//writeInstructionData(line);
-					string operandAndReg = line.substr(3);
-					string gpr = getStoreRegister(operandAndReg);
-					string operand = getStoreOperand(operandAndReg);
-					int len = operand.length();
-					operand = operand.substr(2, len - 3);
-					checkIfRegisterIsValid(operand);
-
-					string code = "80";
-					code += getHexfromInt(getRegisterIndex(operand));
-					code += "0";
-					code += getHexfromInt(getRegisterIndex(gpr));
-					code += "000";
-					writeInstructionData(code);
-					sectionLocationCounter[currentSection] += 4;
+					errorMessage("Error, line " + to_string(lineNum) + ": Symbol value must be defined during assembling!");
 				}
-				continue;
+				int displacement = getLoadStoreDisplacement(disp, parsed.operandKind);
+				writeWord(encode<INSTRUCTION_STORE_REGINDDISP, MODE_REGISTER>(getRegisterIndex(gpr), getRegisterIndex(reg), displacement));
+				sectionLocationCounter[currentSection] += 4;
 			}
-			if (isInstructionStoreRegIndDisp(line))
+			break;
+		}
+
+		// CONTROL/STATUS INSTRUCTIONS
+		case INSTRUCTION_CSRRD:
+		{
+			if (pass == FIRST)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string operandAndReg = line.substr(3);
-					string gpr = getStoreRegister(operandAndReg);
-					string reg = getIndDispRegister(getStoreOperand(operandAndReg));
-					string disp = getIndDispSymOrLit(getStoreOperand(operandAndReg));
-					checkIfRegisterIsValid(reg);
-
-					string hexNum;
-					string code = "80";
-					code += getHexfromInt(getRegisterIndex(reg));
-					code += "0";
-					code += getHexfromInt(getRegisterIndex(gpr));
-					if (isSymbol(disp))
-					{
-						errorMessage("Error, line " + to_string(lineNum) + ": Symbol value must be defined during assembling!");
-					}
-					else
-					{
-						hexNum = getLoadStoreHexDisplacement(disp);
-					}
-					code += hexNum;
-					writeInstructionData(code);
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
+			}
+			if (pass == SECOND)
+			{
+				//writeInstructionData(line);
+				string csr = parsed.reg1;
+				string gpr = parsed.reg2;
+				writeWord(encode<INSTRUCTION_CSRRD, MODE_REGISTER>(getRegisterIndex(csr), getRegisterIndex(gpr), 0));
+				sectionLocationCounter[currentSection] += 4;
 			}
+			break;
+		}
+		case INSTRUCTION_CSRWR:
+		{
+			if (pass == FIRST)
+			{
+				sectionLocationCounter[currentSection] += getInstructionSize(parsed.type, statement.mode);
+			}
+			if (pass == SECOND)
+			{
+				//writeInstructionData(line);
+				string gpr = parsed.reg1;
+				string csr = parsed.reg2;
+				writeWord(encode<INSTRUCTION_CSRWR, MODE_REGISTER>(getRegisterIndex(gpr), getRegisterIndex(csr), 0));
+				sectionLocationCounter[currentSection] += 4;
+			}
+			break;
+		}
+
+		/*
+		SYMBOLS
+		*/
 
-			// CONTROL/STATUS INSTRUCTIONS
-			if (isInstructionCsrrd(line))
+		case LINE_LABEL:
+		{
+			if (pass == FIRST)
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string regs = line.substr(6);
-					string csr = getFirstRegister(regs);
-					string gpr = getSecondRegister(regs);
-					string code = "90";
-					code += getHexfromInt(getRegisterIndex(gpr));
-					code += getHexfromInt(getRegisterIndex(csr));
-					code += "0000";
-					writeInstructionData(code);
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				addNewSymbolToSymtab(statement.name);
 			}
-			if (isInstructionCsrwr(line))
+			break;
+		}
+
+		default:
+			errorMessage("Error, line " + to_string(lineNum) + ": Line not recognized by assembler: " + parsed.operand);
+		}
+
+		if ((pass == SECOND) && !statement.literalPool.empty())
+		{
+			writeLiteralPool(statement.literalPool);
+		}
+
+		if ((pass == FIRST) && (parsed.type != DIRECTIVE_SECTION))
+		{
+			map<string, unsigned int>::iterator counterAfter = sectionLocationCounter.find(statementSection);
+			statement.section = statementSection;
+			statement.offset = statementOffset;
+			statement.length = (counterAfter != sectionLocationCounter.end()) ? counterAfter->second - statementOffset : 0;
+		}
+	}
+
+	if (pass == SECOND)
+	{
+		for (map<string, vector<LiteralKey>>::iterator it = sectionLiteralPool.begin(); it != sectionLiteralPool.end(); it++)
+		{
+			currentSection = it->first;
+			currentSectionName = StringInterner::find(it->first);
+			writeLiteralPool(it->second);
+		}
+	}
+	if (pass == FIRST)
+	{
+		layoutSections();
+		combineSymbolTable();
+		addSectionsToSectab();
+	}
+}
+
+bool Assembler::isRelaxationCandidate(Statement& statement)
+{
+	bool branch = (findEncoding(statement.parsed.type, MODE_RELATIVE) != -1);
+	return branch && (statement.parsed.operandKind == OPERAND_SYMBOL);
+}
+
+Assembler::LiteralKey Assembler::getLiteralKey(Statement& statement)
+{
+	if (statement.parsed.operandKind == OPERAND_SYMBOL) return statement.name;
+	return LITERAL_CONSTANT | statement.literal;
+}
+
+void Assembler::placeLiteralPool(LiteralPool& pool, unsigned int offset, unordered_map<LiteralKey, unsigned int>& placed)
+{
+	for (size_t i = 0; i < pool.entries.size(); i++)
+	{
+		placed[pool.entries[i]] = offset + 4 * i;
+	}
+	for (size_t i = 0; i < pool.references.size(); i++)
+	{
+		Statement& statement = *pool.references[i];
+		statement.literalOffset = offset + 4 * pool.index[getLiteralKey(statement)];
+	}
+}
+
+bool Assembler::isLiteralPoolSpot(Statement& statement)
+{
+	// Nothing falls through into the bytes after these
+	switch (statement.parsed.type)
+	{
+	case INSTRUCTION_HALT: case INSTRUCTION_IRET: case INSTRUCTION_RET:
+	case INSTRUCTION_JMP: case DIRECTIVE_LTORG:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool Assembler::literalPoolReaches(LiteralPool& pool, unsigned int end)
+{
+	// The last entry ends at end, the oldest reference reads from the farthest
+	unsigned int lastEntry = end - 4;
+	return lastEntry - (pool.firstReference + 4) <= 2047;
+}
+
+bool Assembler::literalPoolFitsUntilNextSpot(size_t i, LiteralPool& pool, unsigned int location)
+{
+	// Grow the pool by every new literal up to the next spot and check it there
+	string& section = statements[i].section;
+	set<LiteralKey> added;
+	for (size_t j = i + 1; j < statements.size(); j++)
+	{
+		Statement& statement = statements[j];
+		if (statement.parsed.type == DIRECTIVE_END) break;
+		if ((statement.parsed.type == DIRECTIVE_SECTION) || (statement.section != section)) continue;
+
+		location += statement.length;
+		if (statement.mode == MODE_POOL)
+		{
+			LiteralKey key = getLiteralKey(statement);
+			if (pool.index.find(key) == pool.index.end()) added.insert(key);
+		}
+		if (isLiteralPoolSpot(statement)) break;
+	}
+	return literalPoolReaches(pool, location + 4 * (pool.entries.size() + added.size()));
+}
+
+void Assembler::layoutSections()
+{
+	/*
+	*	Each 32-bit operand is read pc-relative from a literal pool, so the
+	*	instruction itself is always 4 bytes. Pools go at .ltorg, at the end
+	*	of the section, or right after a halt, iret, ret or jmp, where code
+	*	never runs into them and no data is split. Such a spot is taken when
+	*	the oldest pending reference could not reach the pool at the next one,
+	*	a reference with no spot in range is an error. Branches to a label in
+	*	range need no literal at all, and every dropped literal can bring other
+	*	labels closer. A branch pushed out of range by a pool keeps its
+	*	literal for good, so the layout always settles.
+	*/
+	bool changed = true;
+	map<string, unsigned int> counter;
+	unordered_map<Atom, Statement*> labels;
+	unsigned int outOfRangeLine = 0;
+	while (changed)
+	{
+		changed = false;
+		outOfRangeLine = 0;
+		counter.clear();
+		labels.clear();
+		sectionLiteralPool.clear();
+
+		map<string, LiteralPool> pending;
+		map<string, unordered_map<LiteralKey, unsigned int>> placed;
+		for (size_t i = 0; i < statements.size(); i++)
+		{
+			Statement& statement = statements[i];
+			if (statement.parsed.type == DIRECTIVE_END) break;
+			statement.literalPool.clear();
+			if (statement.parsed.type == DIRECTIVE_SECTION) continue;
+
+			string& section = statement.section;
+			unsigned int& location = counter[section];
+			LiteralPool& pool = pending[section];
+			bool literal = (statement.mode == MODE_POOL);
+
+			if (!pool.entries.empty() && (outOfRangeLine == 0))
 			{
-				if (pass == FIRST)
-				{
-					sectionLocationCounter[currentSection] += 4;
-				}
-				if (pass == SECOND)
-				{
-					//writeInstructionData(line);
-					string regs = line.substr(6);
-					string gpr = getFirstRegister(regs);
-					string csr = getSecondRegister(regs);
-					string code = "94";
-					code += getHexfromInt(getRegisterIndex(csr));
-					code += getHexfromInt(getRegisterIndex(gpr));
-					code += "0000";
-					writeInstructionData(code);
-					sectionLocationCounter[currentSection] += 4;
-				}
-				continue;
+				// Reported only if the layout settles like this
+				bool added = literal && (pool.index.find(getLiteralKey(statement)) == pool.index.end());
+				unsigned int end = location + statement.length + 4 * (pool.entries.size() + (added ? 1 : 0));
+				if (!literalPoolReaches(pool, end)) outOfRangeLine = pool.references[0]->lineNum;
 			}
 
-			/*
-			SYMBOLS
-			*/
+			statement.offset = location;
+			if (statement.parsed.type == LINE_LABEL) labels[statement.name] = &statement;
 
-			if (isLabel(line))
+			if (literal)
 			{
-				if (pass == FIRST)
+				LiteralKey key = getLiteralKey(statement);
+				unordered_map<LiteralKey, unsigned int>::iterator previous = placed[section].find(key);
+				if ((pool.index.find(key) == pool.index.end()) && (previous != placed[section].end()) &&
+					(location + 4 - previous->second <= 2048))
 				{
-					string label = getLabelName(line);
-					addNewSymbolToSymtab(label);
+					statement.literalOffset = previous->second;
 				}
-				if (pass == SECOND)
+				else
 				{
-					//writeInstructionData(line);
+					if (pool.entries.empty()) pool.firstReference = location;
+					if (pool.index.find(key) == pool.index.end())
+					{
+						pool.index[key] = pool.entries.size();
+						pool.entries.push_back(key);
+					}
+					pool.references.push_back(&statement);
 				}
-				continue;
 			}
+			location += statement.length;
 
-			errorMessage("Error, line " + to_string(lineNum) + ": Line not recognized by assembler: " + line);
+			if (!pool.entries.empty() && isLiteralPoolSpot(statement) &&
+				((statement.parsed.type == DIRECTIVE_LTORG) || !literalPoolFitsUntilNextSpot(i, pool, location)))
+			{
+				statement.literalPool = pool.entries;
+				placeLiteralPool(pool, location, placed[section]);
+				location += 4 * pool.entries.size();
+				pool = LiteralPool();
+			}
 		}
 
-		if (pass == FIRST)
+		for (map<string, LiteralPool>::iterator it = pending.begin(); it != pending.end(); it++)
 		{
-			combineSymbolTable();
-			addSectionsToSectab();
+			if (it->second.entries.empty()) continue;
+			sectionLiteralPool[it->first] = it->second.entries;
+			placeLiteralPool(it->second, counter[it->first], placed[it->first]);
+			counter[it->first] += 4 * it->second.entries.size();
 		}
-		if (pass == SECOND)
+
+		for (size_t i = 0; i < statements.size(); i++)
 		{
-			
+			Statement& statement = statements[i];
+			if (statement.parsed.type == DIRECTIVE_END) break;
+			if (statement.noRelax || !isRelaxationCandidate(statement)) continue;
+
+			unordered_map<Atom, Statement*>::iterator label = labels.find(statement.name);
+			bool inRange = false;
+			if ((label != labels.end()) && (label->second->section == statement.section))
+			{
+				long long disp = (long long)label->second->offset - (statement.offset + 4);
+				inRange = (disp >= -2048) && (disp <= 2047);
+			}
+
+			bool relaxed = (statement.mode == MODE_RELATIVE);
+			if (relaxed && !inRange)
+			{
+				statement.mode = MODE_POOL;
+				statement.noRelax = true;
+				changed = true;
+			}
+			else if (!relaxed && inRange)
+			{
+				statement.mode = MODE_RELATIVE;
+				changed = true;
+			}
+			statement.length = getInstructionSize(statement.parsed.type, statement.mode);
 		}
+	}
+	if (outOfRangeLine != 0)
+	{
+		errorMessage("Error, line " + to_string(outOfRangeLine) + ": Literal pool out of range, add a jmp or .ltorg within 2048 bytes");
+	}
 
-		file.close();
+	// Move labels and section sizes to the final layout
+	for (unordered_map<Atom, Statement*>::iterator it = labels.begin(); it != labels.end(); it++)
+	{
+		int position = symbolListIndex.find(it->first, symbolList);
+		if (position != -1) symbolList[position].value = it->second->offset;
 	}
-	else
+	for (map<string, unsigned int>::iterator it = counter.begin(); it != counter.end(); it++)
+	{
+		map<string, unsigned int>::iterator section = sectionLocationCounter.find(it->first);
+		if (section != sectionLocationCounter.end()) section->second = it->second;
+	}
+}
+
+void Assembler::writeLiteralPool(vector<LiteralKey>& entries)
+{
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		if (entries[i] & LITERAL_CONSTANT)
+		{
+			writeWord((uint32_t)entries[i]);
+		}
+		else
+		{
+			writeWord(0);
+			addRecordToReltab((Atom)entries[i]);
+		}
+		sectionLocationCounter[currentSection] += 4;
+	}
+}
+
+int Assembler::getRelativeDisplacement(Atom symbol)
+{
+	int position = findSymbol(symbol);
+	if (position == -1)
 	{
-		errorMessage("Error opening file 'temp.s'");
+		errorMessage("Error, line " + to_string(lineNum) + ": Symbol not in SymbolTable!\n");
 	}
+	return (int)symtab[position].value - (int)(sectionLocationCounter[currentSection] + 4);
+}
+
+int Assembler::getLiteralPoolDisplacement(Statement& statement)
+{
+	return (int)statement.literalOffset - (int)(sectionLocationCounter[currentSection] + 4);
+}
+
+int Assembler::getOperandDisplacement(Statement& statement)
+{
+	if (statement.mode == MODE_RELATIVE) return getRelativeDisplacement(statement.name);
+	if (statement.mode == MODE_POOL) return getLiteralPoolDisplacement(statement);
+	return statement.literal;
 }
 
 void Assembler::generateObjectFile()
@@ -1702,10 +1432,15 @@ void Assembler::generateObjectFile()
 	assemblerPass(FIRST);
 	assemblerPass(SECOND);
 	createOutputFile();
-	remove(FORMATED_FILE);
 }
 
 void Assembler::createOutputFile()
+{
+	if (textOutput) createTextOutputFile();
+	else createBinaryOutputFile();
+}
+
+void Assembler::createTextOutputFile()
 {
 	ofstream outputFile(outputFileName);
 
@@ -1721,3 +1456,105 @@ void Assembler::createOutputFile()
 		errorMessage("Error opening file '" + outputFileName + "'");
 	}
 }
+
+unsigned int Assembler::addToStringTable(Atom name, vector<char>& strtab, unordered_map<Atom, unsigned int>& strtabIndex)
+{
+	unordered_map<Atom, unsigned int>::iterator it = strtabIndex.find(name);
+	if (it != strtabIndex.end()) return it->second;
+	unsigned int offset = strtab.size();
+	const string& str = StringInterner::name(name);
+	strtab.insert(strtab.end(), str.begin(), str.end());
+	strtab.push_back('\0');
+	strtabIndex[name] = offset;
+	return offset;
+}
+
+void Assembler::createBinaryOutputFile()
+{
+	vector<char> strtab;
+	unordered_map<Atom, unsigned int> strtabIndex;
+	addToStringTable(0, strtab, strtabIndex);
+
+	vector<ObjectSection> sections;
+	vector<ObjectRelocation> relocations;
+	vector<vector<uint8_t>*> sectionBytes;
+	for (SectionTable* cur = sectab; cur != nullptr; cur = cur->next)
+	{
+		ObjectSection section;
+		section.name = addToStringTable(cur->entry.name, strtab, strtabIndex);
+		section.size = cur->entry.value;
+		section.dataOffset = 0;
+		section.relocationIndex = relocations.size();
+		for (RelocationTable* rel = reltab; rel != nullptr; rel = rel->next)
+		{
+			if (rel->entry.section != cur->entry.name) continue;
+			ObjectRelocation relocation;
+			relocation.offset = rel->entry.offset;
+			relocation.type = rel->entry.type;
+			relocation.symbol = addToStringTable(rel->entry.symbol, strtab, strtabIndex);
+			relocation.addend = rel->entry.addend;
+			relocations.push_back(relocation);
+		}
+		section.relocationCount = relocations.size() - section.relocationIndex;
+		sections.push_back(section);
+		vector<uint8_t>& bytes = sectionData[StringInterner::name(cur->entry.name)];
+		bytes.resize(cur->entry.value, 0);
+		sectionBytes.push_back(&bytes);
+	}
+
+	vector<ObjectSymbol> symbols;
+	for (size_t i = 0; i < symtab.size(); i++)
+	{
+		ObjectSymbol symbol;
+		symbol.name = addToStringTable(symtab[i].name, strtab, strtabIndex);
+		symbol.id = symtab[i].id;
+		symbol.value = symtab[i].value;
+		symbol.sectionId = symtab[i].sectionId;
+		symbol.type = (symtab[i].type == SECTION) ? OBJ_SYM_SECTION : OBJ_SYM_NOTYPE;
+		if (symtab[i].binding == LOCAL) symbol.binding = OBJ_BIND_LOCAL;
+		else if (symtab[i].binding == GLOBAL) symbol.binding = OBJ_BIND_GLOBAL;
+		else if (symtab[i].binding == EXTERN) symbol.binding = OBJ_BIND_EXTERN;
+		else symbol.binding = OBJ_BIND_UNDEFINED;
+		symbol.reserved = 0;
+		symbols.push_back(symbol);
+	}
+
+	ObjectFileHeader header;
+	header.magic = OBJ_MAGIC;
+	header.version = OBJ_VERSION;
+	header.sectionCount = sections.size();
+	header.symbolCount = symbols.size();
+	header.relocationCount = relocations.size();
+	header.stringTableSize = strtab.size();
+	header.sectionTableOffset = sizeof(ObjectFileHeader);
+	header.symbolTableOffset = header.sectionTableOffset + sections.size() * sizeof(ObjectSection);
+	header.relocationTableOffset = header.symbolTableOffset + symbols.size() * sizeof(ObjectSymbol);
+	unsigned int offset = header.relocationTableOffset + relocations.size() * sizeof(ObjectRelocation);
+	for (size_t i = 0; i < sections.size(); i++)
+	{
+		sections[i].dataOffset = offset;
+		offset += (sections[i].size + 3) & ~3u;
+	}
+	header.stringTableOffset = offset;
+
+	ofstream outputFile(outputFileName, ios::binary);
+	if (outputFile.is_open())
+	{
+		const char padding[4] = { 0, 0, 0, 0 };
+		outputFile.write((const char*)&header, sizeof(header));
+		outputFile.write((const char*)sections.data(), sections.size() * sizeof(ObjectSection));
+		outputFile.write((const char*)symbols.data(), symbols.size() * sizeof(ObjectSymbol));
+		outputFile.write((const char*)relocations.data(), relocations.size() * sizeof(ObjectRelocation));
+		for (size_t i = 0; i < sectionBytes.size(); i++)
+		{
+			outputFile.write((const char*)sectionBytes[i]->data(), sectionBytes[i]->size());
+			outputFile.write(padding, ((sectionBytes[i]->size() + 3) & ~3u) - sectionBytes[i]->size());
+		}
+		outputFile.write(strtab.data(), strtab.size());
+		outputFile.close();
+	}
+	else
+	{
+		errorMessage("Error opening file '" + outputFileName + "'");
+	}
+}
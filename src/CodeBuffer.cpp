@@ -0,0 +1,33 @@
+#include "CodeBuffer.h"
+
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+CodeBuffer::CodeBuffer()
+{
+	used = 0;
+	pageSize = sysconf(_SC_PAGESIZE);
+	void* mapped = mmap(nullptr, BUFFER_SIZE, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	base = (mapped == MAP_FAILED) ? nullptr : (uint8_t*)mapped;
+}
+
+CodeBuffer::~CodeBuffer()
+{
+	if (base != nullptr) munmap(base, BUFFER_SIZE);
+}
+
+const void* CodeBuffer::add(const vector<uint8_t>& code)
+{
+	size_t start = (used + CODE_ALIGNMENT - 1) & ~(CODE_ALIGNMENT - 1);
+	if ((base == nullptr) || (start + code.size() > BUFFER_SIZE)) return nullptr;
+
+	size_t firstPage = start & ~(pageSize - 1);
+	size_t length = start + code.size() - firstPage;
+	if (mprotect(base + firstPage, length, PROT_READ | PROT_WRITE) != 0) return nullptr;
+	memcpy(base + start, code.data(), code.size());
+	if (mprotect(base + firstPage, length, PROT_READ | PROT_EXEC) != 0) return nullptr;
+
+	used = start + code.size();
+	return base + start;
+}
@@ -1,60 +1,784 @@
 #include "Emulator.h"
 
-Emulator::Emulator(string inputHexFile)
+#include <csignal>
+
+// Terminal settings in effect before the emulator switched stdin to raw mode
+static struct termios savedTerminal;
+static volatile sig_atomic_t rawTerminal = 0;
+
+static void restoreTerminalAtExit()
+{
+	if (rawTerminal) tcsetattr(STDIN_FILENO, TCSANOW, &savedTerminal);
+	rawTerminal = 0;
+}
+
+static void restoreTerminalOnSignal(int sig)
+{
+	restoreTerminalAtExit();
+	signal(sig, SIG_DFL);
+	raise(sig);
+}
+
+Emulator::Emulator(string inputHexFile, unsigned int jitThreshold)
 {
 	inputFileName = inputHexFile;
+	this->jitThreshold = jitThreshold;
+	codeBuffer = (jitThreshold != 0) ? new CodeBuffer() : nullptr;
+	pageTable.assign(PAGE_COUNT, nullptr);
+	blockPages.assign(PAGE_COUNT, nullptr);
+	blockEpoch = 0;
+	runningPage = PAGE_COUNT;
+	blockBroken = false;
+	opLabels = nullptr;
+	instructionCount = 0;
+	nextEventTime = UINT64_MAX;
+	pendingInterrupts = 0;
+	timerGeneration = 0;
+}
+
+Emulator::~Emulator()
+{
+	for (size_t i = 0; i < pageTable.size(); i++)
+	{
+		delete[] pageTable[i];
+		if (blockPages[i] != nullptr)
+		{
+			for (size_t j = 0; j < blockPages[i]->blocks.size(); j++) delete blockPages[i]->blocks[j];
+			delete blockPages[i];
+		}
+	}
+	freeRetiredBlocks();
+	delete codeBuffer;
+	restoreTerminal();
 }
 
 void Emulator::errorMessage(string msg)
 {
+	flushTerminal();
+	restoreTerminal();
 	cerr << msg << endl;
 	exit(1);
 }
 
-string Emulator::formatHexData(string hex)
+unsigned char* Emulator::getPage(unsigned int address)
 {
-	stringstream ss;
-	for (int i = 3; i >= 0; i--)
+	unsigned char*& page = pageTable[address >> PAGE_BITS];
+	if (page == nullptr)
 	{
-		ss << hex[2 * i] << hex[2 * i + 1];
+		page = new unsigned char[PAGE_SIZE]();
 	}
-	return ss.str();
+	return page;
+}
+
+unsigned char Emulator::readByte(unsigned int address)
+{
+	unsigned char* page = pageTable[address >> PAGE_BITS];
+	if (page == nullptr) return 0;
+	return page[address & (PAGE_SIZE - 1)];
 }
 
-unsigned int& Emulator::getGPRegister(char index)
+void Emulator::writeByte(unsigned int address, unsigned char value)
 {
-	if (index == '0') return r0;
-	if (index == '1') return r1;
-	if (index == '2') return r2;
-	if (index == '3') return r3;
-	if (index == '4') return r4;
-	if (index == '5') return r5;
-	if (index == '6') return r6;
-	if (index == '7') return r7;
-	if (index == '8') return r8;
-	if (index == '9') return r9;
-	if (index == 'A') return r10;
-	if (index == 'B') return r11;
-	if (index == 'C') return r12;
-	if (index == 'D') return r13;
-	if (index == 'E') return r14;
-	if (index == 'F') return r15;
-	return r0;
+	invalidateBlocks(address, 1);
+	getPage(address)[address & (PAGE_SIZE - 1)] = value;
+	if (address >= DEVICE_BASE) writeDeviceRegister(address, 1);
 }
 
-unsigned int& Emulator::getCSRegister(char index)
+unsigned int Emulator::readWord(unsigned int address)
 {
-	if (index == '0') return status;
-	if (index == '1') return handler;
-	if (index == '2') return cause;
-	return status;
+	if (address >= DEVICE_BASE - 3) readDeviceRegister(address, 4);
+	unsigned int offset = address & (PAGE_SIZE - 1);
+	unsigned char* page = pageTable[address >> PAGE_BITS];
+	if ((page == nullptr) || (offset > PAGE_SIZE - 4))
+	{
+		// Unallocated page or word crossing a page boundary
+		return readByte(address) | (readByte(address + 1) << 8) | (readByte(address + 2) << 16) | ((unsigned int)readByte(address + 3) << 24);
+	}
+	unsigned char* data = page + offset;
+	return data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned int)data[3] << 24);
+}
+
+void Emulator::writeWord(unsigned int address, unsigned int value)
+{
+	unsigned int offset = address & (PAGE_SIZE - 1);
+	if (offset > PAGE_SIZE - 4)
+	{
+		for (int i = 0; i < 4; i++) writeByte(address + i, (value >> (8 * i)) & 0xFF);
+		return;
+	}
+	invalidateBlocks(address, 4);
+	unsigned char* data = getPage(address) + offset;
+	data[0] = value & 0xFF;
+	data[1] = (value >> 8) & 0xFF;
+	data[2] = (value >> 16) & 0xFF;
+	data[3] = (value >> 24) & 0xFF;
+	if (address + 3 >= DEVICE_BASE) writeDeviceRegister(address, 4);
+}
+
+Emulator::DecodedInstruction Emulator::decodeInstruction(unsigned int word)
+{
+	/*
+	*	Instruction bytes in memory: [OC|MOD] [A|B] [C|D11..8] [D7..0]
+	*/
+	DecodedInstruction decoded;
+	decoded.opcode = word & 0xFF;
+	decoded.a = (word >> 12) & 0xF;
+	decoded.b = (word >> 8) & 0xF;
+	decoded.c = (word >> 20) & 0xF;
+	decoded.disp = ((word >> 8) & 0xF00) | (word >> 24);
+	if (decoded.disp & 0x800)
+	{
+		decoded.disp |= 0xFFFFF000;
+	}
+
+	// Nonexistent control registers alias status
+	if ((decoded.opcode == 0x90) && (decoded.b >= CSR_COUNT)) decoded.b = STATUS;
+	if ((0x94 <= decoded.opcode) && (decoded.opcode <= 0x97) && (decoded.a >= CSR_COUNT)) decoded.a = STATUS;
+	return decoded;
+}
+
+bool Emulator::endsBlock(const DecodedInstruction& ins)
+{
+	switch (ins.opcode)
+	{
+	case 0x00: case 0x10: case 0x20: case 0x21:
+	case 0x30: case 0x31: case 0x32: case 0x33:
+	case 0x38: case 0x39: case 0x3A: case 0x3B:
+		return true;
+	case 0x40:
+		return (ins.b == PC) || (ins.c == PC);
+	case 0x93: case 0x97:
+		return (ins.a == PC) || (ins.b == PC);
+	case 0x50: case 0x51: case 0x52: case 0x53:
+	case 0x60: case 0x61: case 0x62: case 0x63:
+	case 0x70: case 0x71: case 0x81:
+	case 0x90: case 0x91: case 0x92:
+		return ins.a == PC;
+	default:
+		return false;
+	}
+}
+
+void Emulator::foldLiteral(DecodedInstruction& ins, unsigned int next, TranslatedBlock* block)
+{
+	// Forms that read an operand from memory, the fields that make up the
+	// address and the form that takes the operand as displacement instead
+	unsigned char* first;
+	unsigned char* second = nullptr;
+	unsigned char folded;
+	switch (ins.opcode)
+	{
+	case 0x21: first = &ins.a; second = &ins.b; folded = 0x20; break;
+	case 0x38: case 0x39: case 0x3A: case 0x3B: first = &ins.a; folded = ins.opcode - 0x8; break;
+	case 0x82: first = &ins.a; second = &ins.b; folded = 0x80; break;
+	case 0x92: first = &ins.b; second = &ins.c; folded = 0x91; break;
+	case 0x96: first = &ins.b; second = &ins.c; folded = 0x95; break;
+	default: return;
+	}
+	bool onlyPc = (*first == PC) && ((second == nullptr) || (*second == 0));
+	bool swapped = (second != nullptr) && (*first == 0) && (*second == PC);
+	if (!onlyPc && !swapped) return;
+
+	// The pool word must be retired with the block, so it has to be in its page
+	unsigned int address = next + ins.disp;
+	if ((address & 0x3) || ((address >> PAGE_BITS) != (block->start >> PAGE_BITS)) || (address >= DEVICE_BASE)) return;
+	ins.opcode = folded;
+	ins.disp = readWord(address);
+	*first = 0;
+	if (second != nullptr) *second = 0;
+	block->low = min(block->low, address);
+	block->high = max(block->high, address + 4);
+}
+
+Emulator::TranslatedBlock* Emulator::translateBlock(unsigned int address)
+{
+	TranslatedBlock* block = new TranslatedBlock();
+	block->start = address;
+	block->low = block->high = address;
+	block->chainEpoch = blockEpoch;
+	block->chainAddress[0] = block->chainAddress[1] = 1;
+	block->chainBlock[0] = block->chainBlock[1] = nullptr;
+	block->runCount = 0;
+	block->native = nullptr;
+
+	unsigned int pc = address;
+	while (true)
+	{
+		DecodedInstruction ins = decodeInstruction(readWord(pc));
+		foldLiteral(ins, pc + 4, block);
+		BlockOp op;
+		op.target = opLabels[ins.opcode];
+		// r0 is hardwired to zero, an op that only writes it does nothing
+		bool writesA = ((0x50 <= ins.opcode) && (ins.opcode <= 0x71)) || ((0x90 <= ins.opcode) && (ins.opcode <= 0x92));
+		if (writesA && (ins.a == 0)) op.target = opLabels[LABEL_NOP];
+		bool readsPc = endsBlock(ins) || (ins.a == PC) || (ins.b == PC) || (ins.c == PC);
+		op.label = readsPc ? opLabels[LABEL_SET_PC] : op.target;
+		op.opcode = ins.opcode;
+		op.a = ins.a;
+		op.b = ins.b;
+		op.c = ins.c;
+		op.disp = ins.disp;
+		op.next = pc + 4;
+		block->ops.push_back(op);
+		pc += 4;
+
+		// Blocks stay inside one page so a store retires them page by page
+		if (endsBlock(ins) || (block->ops.size() == MAX_BLOCK_LENGTH)) break;
+		if (((pc >> PAGE_BITS) != (address >> PAGE_BITS)) || ((pc & (PAGE_SIZE - 1)) > PAGE_SIZE - 4)) break;
+	}
+	block->end = pc;
+	block->high = max(block->high, pc);
+
+	// Falling off the end leaves pc after the last op
+	block->ops.back().label = opLabels[LABEL_SET_PC];
+	BlockOp sentinel;
+	sentinel.label = opLabels[LABEL_BLOCK_END];
+	sentinel.next = pc;
+	block->ops.push_back(sentinel);
+	return block;
+}
+
+Emulator::TranslatedBlock* Emulator::findBlock(unsigned int address)
+{
+	if (address & 0x3)
+	{
+		// Unaligned code is translated for a single run
+		TranslatedBlock* block = translateBlock(address);
+		retiredBlocks.push_back(block);
+		nextEventTime = 0;
+		return block;
+	}
+
+	BlockPage*& page = blockPages[address >> PAGE_BITS];
+	if (page == nullptr)
+	{
+		page = new BlockPage();
+		page->low = PAGE_SIZE;
+		page->high = 0;
+	}
+	TranslatedBlock*& slot = page->slots[(address & (PAGE_SIZE - 1)) >> 2];
+	if (slot == nullptr)
+	{
+		slot = translateBlock(address);
+		page->blocks.push_back(slot);
+		unsigned int pageBase = address & ~(PAGE_SIZE - 1);
+		page->low = min(page->low, slot->low - pageBase);
+		page->high = max(page->high, slot->high - pageBase);
+	}
+	return slot;
+}
+
+Emulator::TranslatedBlock* Emulator::nextBlock(TranslatedBlock* previous, unsigned int address)
+{
+	if (previous == nullptr) return findBlock(address);
+
+	if (previous->chainEpoch != blockEpoch)
+	{
+		previous->chainAddress[0] = previous->chainAddress[1] = 1;
+		previous->chainBlock[0] = previous->chainBlock[1] = nullptr;
+		previous->chainEpoch = blockEpoch;
+	}
+	int way = (address == previous->end) ? 1 : 0;
+	if ((previous->chainBlock[way] != nullptr) && (previous->chainAddress[way] == address)) return previous->chainBlock[way];
+
+	TranslatedBlock* block = findBlock(address);
+	if (!(address & 0x3))
+	{
+		previous->chainAddress[way] = address;
+		previous->chainBlock[way] = block;
+	}
+	return block;
+}
+
+void Emulator::invalidateBlocks(unsigned int address, unsigned int size)
+{
+	BlockPage* page = blockPages[address >> PAGE_BITS];
+	if (page == nullptr) return;
+	unsigned int offset = address & (PAGE_SIZE - 1);
+	if ((offset + size <= page->low) || (offset >= page->high)) return;
+
+	// Blocks may still be running or linked from other blocks, free them later
+	retiredBlocks.insert(retiredBlocks.end(), page->blocks.begin(), page->blocks.end());
+	if ((address >> PAGE_BITS) == runningPage) blockBroken = true;
+	delete page;
+	blockPages[address >> PAGE_BITS] = nullptr;
+	blockEpoch++;
+	nextEventTime = 0;
+}
+
+void Emulator::freeRetiredBlocks()
+{
+	for (size_t i = 0; i < retiredBlocks.size(); i++) delete retiredBlocks[i];
+	retiredBlocks.clear();
+}
+
+uint32_t Emulator::jitReadWord(Emulator* emu, uint32_t address)
+{
+	return emu->readWord(address);
+}
+
+void Emulator::jitWriteWord(Emulator* emu, uint32_t address, uint32_t value)
+{
+	emu->writeWord(address, value);
+}
+
+void Emulator::jitCsrWritten(Emulator* emu)
+{
+	emu->recheckInterrupts();
+}
+
+bool Emulator::compileBlock(TranslatedBlock* block)
+{
+#if defined(__x86_64__)
+	if (!codeBuffer->isAvailable()) return false;
+	size_t length = block->ops.size() - 1;
+	for (size_t i = 0; i < length; i++)
+	{
+		const BlockOp& op = block->ops[i];
+		if ((op.opcode == 0x00) || (op.opcode == 0x10) || (op.opcode == 0x96) || (op.opcode == 0x97)) return false;
+		if ((op.opcode == 0x93) && (op.c == 0x1)) return false;
+	}
+
+	// Pin the most used guest registers, r0 and pc are never pinned
+	const HostRegister pinnedHosts[JIT_PINNED_COUNT] = { RBX, R12, R13, R14, R15 };
+	int uses[GPR_COUNT] = { 0 };
+	int pinned[GPR_COUNT];
+	for (int g = 0; g < GPR_COUNT; g++) pinned[g] = -1;
+	for (size_t i = 0; i < length; i++)
+	{
+		uses[block->ops[i].a]++;
+		uses[block->ops[i].b]++;
+		uses[block->ops[i].c]++;
+	}
+	uses[0] = uses[PC] = 0;
+	for (int h = 0; h < JIT_PINNED_COUNT; h++)
+	{
+		int best = 0;
+		for (int g = 1; g < PC; g++)
+		{
+			if ((pinned[g] == -1) && (uses[g] > uses[best])) best = g;
+		}
+		if (uses[best] < 2) break;
+		pinned[best] = pinnedHosts[h];
+	}
+
+	X86Emitter x;
+	bool pcWritten = false;
+
+	auto readGuest = [&](HostRegister dst, int g, unsigned int pcValue)
+	{
+		if (g == 0) x.movRegImm(dst, 0);
+		else if ((g == PC) && !pcWritten) x.movRegImm(dst, pcValue);
+		else if (pinned[g] != -1) x.movRegReg(dst, (HostRegister)pinned[g]);
+		else x.load(dst, RBP, 4 * g);
+	};
+	auto writeGuest = [&](int g, HostRegister src)
+	{
+		if (g == 0) return;
+		if (g == PC) pcWritten = true;
+		if (pinned[g] != -1) x.movRegReg((HostRegister)pinned[g], src);
+		else x.store(RBP, 4 * g, src);
+	};
+	auto emitExit = [&](unsigned int executed)
+	{
+		for (int g = 1; g < PC; g++)
+		{
+			if (pinned[g] != -1) x.store(RBP, 4 * g, (HostRegister)pinned[g]);
+		}
+		x.movRegImm(RAX, executed);
+		x.addRsp(8);
+		for (int h = JIT_PINNED_COUNT - 1; h >= 0; h--) x.pop64(pinnedHosts[h]);
+		x.pop64(RBP);
+		x.ret();
+	};
+	auto callHelper = [&](const void* helper)
+	{
+		x.movRegImm64(RDI, (uint64_t)this);
+		x.movRegImm64(RAX, (uint64_t)helper);
+		x.call64(RAX);
+	};
+	auto exitIfBroken = [&](size_t i)
+	{
+		// Same as block_broken: stop after the store that retired the block
+		if (i == length - 1) return;
+		x.movRegImm64(RAX, (uint64_t)&blockBroken);
+		x.cmpByteZero(RAX);
+		size_t skip = x.jumpForward(JUMP_EQUAL);
+		x.storeImm(RBP, 4 * PC, block->ops[i].next);
+		emitExit(i + 1);
+		x.bindJump(skip);
+	};
+	auto pushReturnAddress = [&](unsigned int next)
+	{
+		readGuest(RSI, SP, next);
+		x.addImm(RSI, (uint32_t)-4);
+		writeGuest(SP, RSI);
+		x.movRegImm(RDX, next);
+		callHelper((const void*)&jitWriteWord);
+	};
+
+	// Prologue, rsp is 16-byte aligned for the helper calls
+	x.push64(RBP);
+	for (int h = 0; h < JIT_PINNED_COUNT; h++) x.push64(pinnedHosts[h]);
+	x.subRsp(8);
+	x.movRegImm64(RBP, (uint64_t)gpr);
+	for (int g = 1; g < PC; g++)
+	{
+		if (pinned[g] != -1) x.load((HostRegister)pinned[g], RBP, 4 * g);
+	}
+	size_t bodyStart = x.position();
+
+	for (size_t i = 0; i < length; i++)
+	{
+		const BlockOp& op = block->ops[i];
+		unsigned int next = op.next;
+		pcWritten = false;
+		// Falling through leaves pc after the last op, control ops overwrite it
+		if (i == length - 1) x.storeImm(RBP, 4 * PC, next);
+
+		switch (op.opcode)
+		{
+		case 0x20:	// CALL
+			readGuest(RAX, op.a, next);
+			readGuest(RCX, op.b, next);
+			x.alu(ALU_ADD, RAX, RCX);
+			x.addImm(RAX, op.disp);
+			x.storeStackSlot(RAX);
+			pushReturnAddress(next);
+			x.loadStackSlot(RAX);
+			writeGuest(PC, RAX);
+			break;
+		case 0x21:
+			readGuest(RSI, op.a, next);
+			readGuest(RCX, op.b, next);
+			x.alu(ALU_ADD, RSI, RCX);
+			x.addImm(RSI, op.disp);
+			callHelper((const void*)&jitReadWord);
+			x.storeStackSlot(RAX);
+			pushReturnAddress(next);
+			x.loadStackSlot(RAX);
+			writeGuest(PC, RAX);
+			break;
+
+		case 0x30:	// JMP, BEQ, BNE, BGT
+		case 0x31:
+		case 0x32:
+		case 0x33:
+		case 0x38:
+		case 0x39:
+		case 0x3A:
+		case 0x3B:
+		{
+			size_t skip = 0;
+			bool conditional = (op.opcode & 0x7) != 0;
+			if (conditional)
+			{
+				readGuest(RAX, op.b, next);
+				readGuest(RCX, op.c, next);
+				x.alu(ALU_CMP, RAX, RCX);
+				int condition = op.opcode & 0x7;
+				skip = x.jumpForward((condition == 1) ? JUMP_NOT_EQUAL : (condition == 2) ? JUMP_EQUAL : JUMP_LESS_OR_EQUAL);
+			}
+			if (op.opcode & 0x8)
+			{
+				readGuest(RSI, op.a, next);
+				x.addImm(RSI, op.disp);
+				callHelper((const void*)&jitReadWord);
+			}
+			else
+			{
+				readGuest(RAX, op.a, next);
+				x.addImm(RAX, op.disp);
+			}
+			writeGuest(PC, RAX);
+			unsigned int loopBase = (op.a == PC) ? next : 0;
+			if (!(op.opcode & 0x8) && ((op.a == PC) || (op.a == 0)) && (loopBase + op.disp == block->start))
+			{
+				// A loop on itself runs again here until an event is due,
+				// pinned registers stay live and each pass is counted
+				x.movRegImm64(RAX, (uint64_t)&instructionCount);
+				x.load64(RCX, RAX, 0);
+				x.movRegImm64(RDX, (uint64_t)&nextEventTime);
+				x.cmp64(RCX, RDX, 0);
+				size_t leave = x.jumpForward(JUMP_ABOVE_OR_EQUAL);
+				x.addImm64(RCX, length);
+				x.store64(RAX, 0, RCX);
+				x.jumpBack(bodyStart);
+				x.bindJump(leave);
+			}
+			if (conditional) x.bindJump(skip);
+			break;
+		}
+
+		case 0x40:	// XCHG
+			readGuest(RAX, op.b, next);
+			readGuest(RCX, op.c, next);
+			writeGuest(op.b, RCX);
+			writeGuest(op.c, RAX);
+			break;
+
+		case 0x50:	// ADD, SUB, MUL, DIV, AND, OR, XOR, SHL, SHR
+		case 0x51:
+		case 0x52:
+		case 0x53:
+		case 0x61:
+		case 0x62:
+		case 0x63:
+		case 0x70:
+		case 0x71:
+			readGuest(RAX, op.b, next);
+			readGuest(RCX, op.c, next);
+			switch (op.opcode)
+			{
+			case 0x50: x.alu(ALU_ADD, RAX, RCX); break;
+			case 0x51: x.alu(ALU_SUB, RAX, RCX); break;
+			case 0x52: x.imul(RAX, RCX); break;
+			case 0x53: x.movRegImm(RDX, 0); x.div(RCX); break;
+			case 0x61: x.alu(ALU_AND, RAX, RCX); break;
+			case 0x62: x.alu(ALU_OR, RAX, RCX); break;
+			case 0x63: x.alu(ALU_XOR, RAX, RCX); break;
+			case 0x70: x.shlCl(RAX); break;
+			case 0x71: x.shrCl(RAX); break;
+			}
+			writeGuest(op.a, RAX);
+			break;
+		case 0x60:	// NOT
+			readGuest(RAX, op.b, next);
+			x.notReg(RAX);
+			writeGuest(op.a, RAX);
+			break;
+
+		case 0x80:	// STORE, PUSH
+			readGuest(RSI, op.a, next);
+			readGuest(RCX, op.b, next);
+			x.alu(ALU_ADD, RSI, RCX);
+			x.addImm(RSI, op.disp);
+			readGuest(RDX, op.c, next);
+			callHelper((const void*)&jitWriteWord);
+			exitIfBroken(i);
+			break;
+		case 0x81:
+			readGuest(RAX, op.a, next);
+			x.addImm(RAX, op.disp);
+			writeGuest(op.a, RAX);
+			x.movRegReg(RSI, RAX);
+			if (op.c == op.a) x.movRegReg(RDX, RAX);
+			else readGuest(RDX, op.c, next);
+			callHelper((const void*)&jitWriteWord);
+			exitIfBroken(i);
+			break;
+		case 0x82:
+			readGuest(RSI, op.a, next);
+			readGuest(RCX, op.b, next);
+			x.alu(ALU_ADD, RSI, RCX);
+			x.addImm(RSI, op.disp);
+			callHelper((const void*)&jitReadWord);
+			x.movRegReg(RSI, RAX);
+			readGuest(RDX, op.c, next);
+			callHelper((const void*)&jitWriteWord);
+			exitIfBroken(i);
+			break;
+
+		case 0x90:	// LOAD, POP, CSRRD, CSRWR
+			x.movRegImm64(RAX, (uint64_t)&csr[op.b]);
+			x.load(RAX, RAX, 0);
+			writeGuest(op.a, RAX);
+			break;
+		case 0x91:
+			readGuest(RAX, op.b, next);
+			x.addImm(RAX, op.disp);
+			writeGuest(op.a, RAX);
+			break;
+		case 0x92:
+			readGuest(RSI, op.b, next);
+			readGuest(RCX, op.c, next);
+			x.alu(ALU_ADD, RSI, RCX);
+			x.addImm(RSI, op.disp);
+			callHelper((const void*)&jitReadWord);
+			writeGuest(op.a, RAX);
+			break;
+		case 0x93:
+			readGuest(RSI, op.b, next);
+			callHelper((const void*)&jitReadWord);
+			writeGuest(op.a, RAX);
+			readGuest(RCX, op.b, next);
+			x.addImm(RCX, op.disp);
+			writeGuest(op.b, RCX);
+			break;
+		case 0x94:
+		case 0x95:
+			readGuest(RAX, op.b, next);
+			if (op.opcode == 0x95) x.addImm(RAX, op.disp);
+			x.movRegImm64(RCX, (uint64_t)&csr[op.a]);
+			x.store(RCX, 0, RAX);
+			callHelper((const void*)&jitCsrWritten);
+			break;
+
+		default:	// unknown opcodes do nothing
+			break;
+		}
+	}
+	emitExit(length);
+
+	const void* code = codeBuffer->add(x.getCode());
+	if (code == nullptr) return false;
+	block->native = (NativeBlock)code;
+	return true;
+#else
+	return false;
+#endif
+}
+
+static const unsigned int timerPeriodMs[] = { 500, 1000, 1500, 2000, 5000, 10000, 30000, 60000 };
+
+void Emulator::scheduleEvent(DeviceEvent device, uint64_t delay, unsigned int generation)
+{
+	ScheduledEvent event;
+	event.time = instructionCount + delay;
+	event.device = device;
+	event.generation = generation;
+	events.push(event);
+	if (event.time < nextEventTime) nextEventTime = event.time;
+}
+
+void Emulator::handleEvents()
+{
+	while (!events.empty() && (events.top().time <= instructionCount))
+	{
+		ScheduledEvent event = events.top();
+		events.pop();
+		switch (event.device)
+		{
+		case EVENT_TIMER:
+			if (event.generation != timerGeneration) break;
+			pendingInterrupts |= timerMask;
+			scheduleEvent(EVENT_TIMER, (uint64_t)timerPeriodMs[readWord(TIM_CFG) & 0x7] * INSTRUCTIONS_PER_MS, timerGeneration);
+			break;
+		case EVENT_TERMINAL:
+			pollTerminal();
+			break;
+		}
+	}
+	nextEventTime = events.empty() ? UINT64_MAX : events.top().time;
+
+	// Masked requests stay pending until status changes, and every request
+	// until a handler is set, there is nowhere to deliver it before that
+	if ((pendingInterrupts == 0) || (csr[STATUS] & interruptMask) || (csr[HANDLER] == 0)) return;
+	unsigned int accepted = pendingInterrupts & ~csr[STATUS];
+	if (accepted & timerMask)
+	{
+		pendingInterrupts &= ~timerMask;
+		acceptInterrupt(CAUSE_TIMER);
+	}
+	else if (accepted & terminalMask)
+	{
+		pendingInterrupts &= ~terminalMask;
+		acceptInterrupt(CAUSE_TERMINAL);
+	}
+}
+
+void Emulator::recheckInterrupts()
+{
+	if (pendingInterrupts != 0) nextEventTime = instructionCount;
+
+	// A handler with terminal interrupts unmasked is waiting for input
+	bool terminalEnabled = (csr[HANDLER] != 0) && !(csr[STATUS] & (interruptMask | terminalMask));
+	if ((terminalInput == nullptr) && terminalEnabled) startTerminalInput();
+}
+
+void Emulator::acceptInterrupt(unsigned int cause)
+{
+	gpr[SP] -= 4;
+	writeWord(gpr[SP], csr[STATUS]);
+	gpr[SP] -= 4;
+	writeWord(gpr[SP], gpr[PC]);
+	csr[CAUSE] = cause;
+	csr[STATUS] = csr[STATUS] | interruptMask;
+	gpr[PC] = csr[HANDLER];
+}
+
+void Emulator::startTimer()
+{
+	timerGeneration++;
+	scheduleEvent(EVENT_TIMER, (uint64_t)timerPeriodMs[readWord(TIM_CFG) & 0x7] * INSTRUCTIONS_PER_MS, timerGeneration);
+}
+
+void Emulator::writeDeviceRegister(unsigned int address, unsigned int size)
+{
+	if ((address <= TIM_CFG + 3) && (address + size > TIM_CFG)) startTimer();
+	if ((address <= TERM_OUT) && (address + size > TERM_OUT))
+	{
+		char c = readByte(TERM_OUT);
+		terminalOutput += c;
+		if (c == '\n') flushTerminal();
+	}
 }
 
-string Emulator::getHexValue(unsigned int val)
+void Emulator::readDeviceRegister(unsigned int address, unsigned int size)
 {
-	stringstream ss;
-	ss << uppercase << hex << setw(8) << setfill('0') << val;
-	return ss.str();
+	if ((address <= TERM_IN + 3) && (address + size > TERM_IN) && (terminalInput == nullptr)) startTerminalInput();
+}
+
+void Emulator::startTerminal()
+{
+	scheduleEvent(EVENT_TERMINAL, TERMINAL_POLL_INTERVAL, 0);
+}
+
+void Emulator::startTerminalInput()
+{
+	if (isatty(STDIN_FILENO) && (tcgetattr(STDIN_FILENO, &savedTerminal) == 0))
+	{
+		// Deliver every key as it is typed, the program echoes what it wants
+		struct termios raw = savedTerminal;
+		raw.c_lflag &= ~(ICANON | ECHO);
+		raw.c_cc[VMIN] = 1;
+		raw.c_cc[VTIME] = 0;
+		if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0)
+		{
+			// Every way out puts the terminal back, exit and fatal signals included
+			rawTerminal = 1;
+			atexit(restoreTerminalAtExit);
+			int signals[] = { SIGINT, SIGTERM, SIGHUP, SIGQUIT, SIGABRT, SIGSEGV };
+			for (size_t i = 0; i < sizeof(signals) / sizeof(signals[0]); i++) signal(signals[i], restoreTerminalOnSignal);
+		}
+	}
+
+	// The reader owns a reference, it may still be blocked in read at exit
+	terminalInput = make_shared<InputQueue>();
+	shared_ptr<InputQueue> input = terminalInput;
+	thread([input]()
+	{
+		char c;
+		while (read(STDIN_FILENO, &c, 1) == 1)
+		{
+			while (!input->push(c)) this_thread::sleep_for(chrono::milliseconds(1));
+		}
+	}).detach();
+}
+
+void Emulator::restoreTerminal()
+{
+	restoreTerminalAtExit();
+}
+
+void Emulator::pollTerminal()
+{
+	// The next character waits until the previous one has been taken
+	char c;
+	if ((terminalInput != nullptr) && !(pendingInterrupts & terminalMask) && terminalInput->pop(c))
+	{
+		writeWord(TERM_IN, (unsigned char)c);
+		pendingInterrupts |= terminalMask;
+	}
+	if (!terminalOutput.empty()) flushTerminal();
+	scheduleEvent(EVENT_TERMINAL, TERMINAL_POLL_INTERVAL, 0);
+}
+
+void Emulator::flushTerminal()
+{
+	cout.write(terminalOutput.data(), terminalOutput.size());
+	cout.flush();
+	terminalOutput.clear();
 }
 
 int Emulator::hexToInt(char c)
@@ -74,8 +798,73 @@ unsigned int Emulator::getIntValueFromHex(string hex)
 	return val;
 }
 
+void Emulator::loadSegment(unsigned int address, const unsigned char* data, unsigned int size)
+{
+	while (size > 0)
+	{
+		unsigned int offset = address & (PAGE_SIZE - 1);
+		unsigned int chunk = PAGE_SIZE - offset;
+		if (chunk > size) chunk = size;
+		memcpy(getPage(address) + offset, data, chunk);
+		address += chunk;
+		data += chunk;
+		size -= chunk;
+	}
+}
+
+bool Emulator::loadImageInMemory()
+{
+	int fd = open(inputFileName.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		errorMessage("Error: Error in opening file '" + inputFileName + "'!");
+	}
+
+	struct stat fileStat;
+	if ((fstat(fd, &fileStat) != 0) || (fileStat.st_size < (off_t)sizeof(ImageFileHeader)))
+	{
+		close(fd);
+		return false;
+	}
+
+	size_t size = fileStat.st_size;
+	void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED)
+	{
+		errorMessage("Error: Error in opening file '" + inputFileName + "'!");
+	}
+
+	const unsigned char* image = (const unsigned char*)mapped;
+	const ImageFileHeader* header = (const ImageFileHeader*)image;
+	if (header->magic != IMG_MAGIC)
+	{
+		munmap(mapped, size);
+		return false;
+	}
+	if ((header->version != IMG_VERSION) ||
+		(header->segmentTableOffset + (size_t)header->segmentCount * sizeof(ImageSegment) > size))
+	{
+		errorMessage("Error: Image file '" + inputFileName + "' is corrupted!");
+	}
+
+	const ImageSegment* segments = (const ImageSegment*)(image + header->segmentTableOffset);
+	for (uint32_t i = 0; i < header->segmentCount; i++)
+	{
+		if (segments[i].dataOffset + (size_t)segments[i].size > size)
+		{
+			errorMessage("Error: Image file '" + inputFileName + "' is corrupted!");
+		}
+		loadSegment(segments[i].address, image + segments[i].dataOffset, segments[i].size);
+	}
+	munmap(mapped, size);
+	return true;
+}
+
 void Emulator::loadProgramInMemory()
 {
+	if (loadImageInMemory()) return;
+
 	ifstream inputFile(inputFileName);
 	if (inputFile.is_open())
 	{
@@ -88,17 +877,13 @@ void Emulator::loadProgramInMemory()
 			string address = regex_replace(line, notAddress, "");
 			string code = regex_replace(line, notCode, "");
 			code = regex_replace(code, space, "");
-			if (code.length() == 8)
-			{
-				memory[getIntValueFromHex(address)] = code;
-			}
-			if (code.length() == 16)
+			if ((code.length() == 8) || (code.length() == 16))
 			{
-				string code1 = code.substr(0, 8);
-				string code2 = code.substr(8, 8);
 				unsigned int adrVal = getIntValueFromHex(address);
-				memory[adrVal] = code1;
-				memory[adrVal + 4] = code2;
+				for (size_t i = 0; i < code.length(); i += 2)
+				{
+					writeByte(adrVal + i / 2, hexToInt(code[i]) * 16 + hexToInt(code[i + 1]));
+				}
 			}
 		}
 	}
@@ -110,368 +895,309 @@ void Emulator::loadProgramInMemory()
 
 void Emulator::executeInstructions()
 {
-	r0  = 0;
-	r1  = 0;
-	r2  = 0;
-	r3  = 0;
-	r4  = 0;
-	r5  = 0;
-	r6  = 0;
-	r7  = 0;
-	r8  = 0;
-	r9  = 0;
-	r10 = 0;
-	r11 = 0;
-	r12 = 0;
-	r13 = 0;
-	r14 = 0;
-	r15 = 0x40000000;
-	status  = 7;
-	handler = 0;
-	cause   = 0;
+	for (int i = 0; i < GPR_COUNT; i++) gpr[i] = 0;
+	gpr[PC] = 0x40000000;
+	csr[STATUS]  = 0;
+	csr[HANDLER] = 0;
+	csr[CAUSE]   = 0;
 
-	while (true)
-	{
-		string instruction = memory[pc];
-		pc += 4;
+	startTimer();
+	startTerminal();
+
+	// Threaded code targets, unknown opcodes do nothing
+	const void* labels[LABEL_COUNT];
+	for (int i = 0; i < LABEL_COUNT; i++) labels[i] = &&op_nop;
+	labels[LABEL_SET_PC] = &&op_set_pc;
+	labels[LABEL_BLOCK_END] = &&block_end;
+	labels[0x00] = &&op_halt;
+	labels[0x10] = &&op_int;
+	labels[0x20] = &&op_call;
+	labels[0x21] = &&op_call_mem;
+	labels[0x30] = &&op_jmp;
+	labels[0x31] = &&op_beq;
+	labels[0x32] = &&op_bne;
+	labels[0x33] = &&op_bgt;
+	labels[0x38] = &&op_jmp_mem;
+	labels[0x39] = &&op_beq_mem;
+	labels[0x3A] = &&op_bne_mem;
+	labels[0x3B] = &&op_bgt_mem;
+	labels[0x40] = &&op_xchg;
+	labels[0x50] = &&op_add;
+	labels[0x51] = &&op_sub;
+	labels[0x52] = &&op_mul;
+	labels[0x53] = &&op_div;
+	labels[0x60] = &&op_not;
+	labels[0x61] = &&op_and;
+	labels[0x62] = &&op_or;
+	labels[0x63] = &&op_xor;
+	labels[0x70] = &&op_shl;
+	labels[0x71] = &&op_shr;
+	labels[0x80] = &&op_st;
+	labels[0x81] = &&op_push;
+	labels[0x82] = &&op_st_mem;
+	labels[0x90] = &&op_csrrd;
+	labels[0x91] = &&op_ld_reg;
+	labels[0x92] = &&op_ld_mem;
+	labels[0x93] = &&op_pop;
+	labels[0x94] = &&op_csrwr;
+	labels[0x95] = &&op_csr_add;
+	labels[0x96] = &&op_csr_mem;
+	labels[0x97] = &&op_csr_pop;
+	opLabels = labels;
+
+	TranslatedBlock* block = nullptr;
+	const BlockOp* op;
+	const BlockOp* end;
+
+	/*
+	*	A handler ends with NEXT, which jumps straight to the handler of the
+	*	following op. Stores end with STORE_NEXT, which leaves the block if
+	*	the store retired it. Ops that end their block already set pc and
+	*	only need NEXT.
+	*/
+#define NEXT		{ op++; goto *op->label; }
+#define STORE_NEXT	{ if (blockBroken) goto block_broken; NEXT }
 
-		if (instruction == "00000000")	// HALT
+block_end:
+	// One compare per block covers due device events and retired blocks
+	if (instructionCount >= nextEventTime)
+	{
+		runningPage = PAGE_COUNT;
+		if (!retiredBlocks.empty())
 		{
-			break;
+			freeRetiredBlocks();
+			block = nullptr;
 		}
-		if (instruction == "10000000")	// INT
+		handleEvents();
+		blockBroken = false;
+	}
+	{
+		// Follow the link to the successor if it is still valid
+		TranslatedBlock* next = nullptr;
+		if ((block != nullptr) && (block->chainEpoch == blockEpoch))
 		{
-			//continue;
-			sp -= 4;
-			memory[sp] = formatHexData(getHexValue(status));
-			sp -= 4;
-			memory[sp] = formatHexData(getHexValue(pc));
-			cause = 4;
-			status = status & (~0x1);
-			pc = handler;
-			continue;
+			if (block->chainAddress[0] == gpr[PC]) next = block->chainBlock[0];
+			else if (block->chainAddress[1] == gpr[PC]) next = block->chainBlock[1];
 		}
-		if (instruction[0] == '2')	// CALL
-		{
-			unsigned int& gpr1 = getGPRegister(instruction[2]);
-			unsigned int& gpr2 = getGPRegister(instruction[3]);
-			unsigned int disp = getIntValueFromHex(instruction.substr(5));
+		block = (next != nullptr) ? next : nextBlock(block, gpr[PC]);
+	}
+	if ((jitThreshold != 0) && (block->native == nullptr) && (++block->runCount == jitThreshold)) compileBlock(block);
+	if (block->native != nullptr)
+	{
+		// Counted up front like threaded code, an early exit gives back the rest
+		unsigned int length = block->ops.size() - 1;
+		runningPage = block->start >> PAGE_BITS;
+		instructionCount += length;
+		unsigned int executed = block->native();
+		instructionCount -= length - executed;
+		blockBroken = false;
+		goto block_end;
+	}
+	op = block->ops.data();
+	end = op + block->ops.size() - 1;
+	instructionCount += end - op;
+	runningPage = block->start >> PAGE_BITS;
+	goto *op->label;
 
-			if (instruction[1] == '0')
-			{
-				unsigned int address = gpr1 + gpr2 + disp;
-				sp -= 4;
-				memory[sp] = formatHexData(getHexValue(pc));
-				pc = address;
-			}
-			if (instruction[1] == '1')
-			{
-				unsigned int address = gpr1 + gpr2 + disp;
-				address = getIntValueFromHex(formatHexData(memory[address]));
-				pc += 4;
-				sp -= 4;
-				memory[sp] = formatHexData(getHexValue(pc));
-				pc = address;
-			}
-			continue;
-		}
-		if (instruction[0] == '3')	// JMP, BEQ, BNE, BGT
-		{
-			unsigned int& gpr1 = getGPRegister(instruction[2]);
-			unsigned int& gpr2 = getGPRegister(instruction[3]);
-			unsigned int& gpr3 = getGPRegister(instruction[4]);
-			unsigned int disp = getIntValueFromHex(instruction.substr(5));
+block_broken:
+	// A store rewrote code of this page, the rest is translated again
+	instructionCount -= end - op - 1;
+	gpr[PC] = op->next;
+	blockBroken = false;
+	goto block_end;
 
-			if (instruction[1] == '0')
-			{
-				pc = gpr1 + disp;
-			}
-			if (instruction[1] == '1')
-			{
-				if (gpr2 == gpr3) pc = gpr1 + disp;
-			}
-			if (instruction[1] == '2')
-			{
-				if (gpr2 != gpr3) pc = gpr1 + disp;
-			}
-			if (instruction[1] == '3')
-			{
-				if ((int)gpr2 > (int)gpr3) pc = gpr1 + disp;
-			}
-			if (instruction[1] == '8')
-			{
-				pc = getIntValueFromHex(formatHexData(memory[gpr1 + disp]));
-			}
-			if (instruction[1] == '9')
-			{
-				if (gpr2 == gpr3) pc = getIntValueFromHex(formatHexData(memory[gpr1 + disp]));
-				else pc += 4;
-			}
-			if (instruction[1] == 'A')
-			{
-				if (gpr2 != gpr3) pc = getIntValueFromHex(formatHexData(memory[gpr1 + disp]));
-				else pc += 4;
-			}
-			if (instruction[1] == 'B')
-			{
-				if ((int)gpr2 > (int)gpr3) pc = getIntValueFromHex(formatHexData(memory[gpr1 + disp]));
-				else pc += 4;
-			}
-			continue;
-		}
-		if (instruction[0] == '4')	// XCHG
-		{
-			unsigned int& gpr1 = getGPRegister(instruction[3]);
-			unsigned int& gpr2 = getGPRegister(instruction[4]);
-			unsigned int temp;
-
-			temp = gpr1;
-			gpr1 = gpr2;
-			gpr2 = temp;
-			continue;
-		}
-		if (instruction[0] == '5')	// ADD, SUB, MUL, DIV
-		{
-			unsigned int& gpr1 = getGPRegister(instruction[2]);
-			unsigned int& gpr2 = getGPRegister(instruction[3]);
-			unsigned int& gpr3 = getGPRegister(instruction[4]);
+op_set_pc:
+	gpr[PC] = op->next;
+	goto *op->target;
 
-			if (instruction[1] == '0')
-			{
-				gpr1 = gpr2 + gpr3;
-			}
-			if (instruction[1] == '1')
-			{
-				gpr1 = gpr2 - gpr3;
-			}
-			if (instruction[1] == '2')
-			{
-				gpr1 = gpr2 * gpr3;
-			}
-			if (instruction[1] == '3')
-			{
-				gpr1 = gpr2 / gpr3;
-			}
-			continue;
-		}
-		if (instruction[0] == '6')	// NOT, AND, OR, XOR
-		{
-			unsigned int& gpr1 = getGPRegister(instruction[2]);
-			unsigned int& gpr2 = getGPRegister(instruction[3]);
-			unsigned int& gpr3 = getGPRegister(instruction[4]);
+op_halt:
+	runningPage = PAGE_COUNT;
+	return;
 
-			if (instruction[1] == '0')
-			{
-				gpr1 = ~gpr2;
-			}
-			if (instruction[1] == '1')
-			{
-				gpr1 = gpr2 & gpr3;
-			}
-			if (instruction[1] == '2')
-			{
-				gpr1 = gpr2 | gpr3;
-			}
-			if (instruction[1] == '3')
-			{
-				gpr1 = gpr2 ^ gpr3;
-			}
-			continue;
-		}
-		if (instruction[0] == '7')	// SHL SHR
-		{
-			unsigned int& gpr1 = getGPRegister(instruction[2]);
-			unsigned int& gpr2 = getGPRegister(instruction[3]);
-			unsigned int& gpr3 = getGPRegister(instruction[4]);
+op_int:
+	gpr[SP] -= 4;
+	writeWord(gpr[SP], csr[STATUS]);
+	gpr[SP] -= 4;
+	writeWord(gpr[SP], gpr[PC]);
+	csr[CAUSE] = CAUSE_SOFTWARE;
+	csr[STATUS] = csr[STATUS] & (~0x1);
+	gpr[PC] = csr[HANDLER];
+	NEXT
 
-			if (instruction[1] == '0')
-			{
-				gpr1 = gpr2 << gpr3;
-			}
-			if (instruction[1] == '1')
-			{
-				gpr1 = gpr2 >> gpr3;
-			}
-			continue;
-		}
-		if (instruction[0] == '8')	// STORE, PUSH
-		{
-			unsigned int& gpr1 = getGPRegister(instruction[2]);
-			unsigned int& gpr2 = getGPRegister(instruction[3]);
-			unsigned int& gpr3 = getGPRegister(instruction[4]);
-			unsigned int disp = getIntValueFromHex(instruction.substr(5));
+op_call:
+{
+	unsigned int address = gpr[op->a] + gpr[op->b] + op->disp;
+	gpr[SP] -= 4;
+	writeWord(gpr[SP], gpr[PC]);
+	gpr[PC] = address;
+	NEXT
+}
+op_call_mem:
+{
+	unsigned int address = readWord(gpr[op->a] + gpr[op->b] + op->disp);
+	gpr[SP] -= 4;
+	writeWord(gpr[SP], gpr[PC]);
+	gpr[PC] = address;
+	NEXT
+}
 
-			if (instruction[1] == '0')
-			{
-				unsigned int address = gpr1 + gpr2 + disp;
-				memory[address] = formatHexData(getHexValue(gpr3));
-			}
-			if (instruction[1] == '2')
-			{
-				unsigned int address = gpr1 + gpr2 + disp;
-				address = getIntValueFromHex(formatHexData(memory[address]));
-				pc += 4;
-				memory[address] = formatHexData(getHexValue(gpr3));
-			}
-			if (instruction[1] == '1')
-			{
-				if (disp & 0x800)
-				{
-					disp |= 0xFFFFF000;
-				}
-				gpr1 = gpr1 + disp;
-				memory[gpr1] = formatHexData(getHexValue(gpr3));
-			}
-			continue;
-		}
-		if (instruction[0] == '9')	// LOAD, POP, CSRRD, CSRWR
-		{
-			if (instruction[1] =='0')
-			{
-				unsigned int& gpr = getGPRegister(instruction[2]);
-				unsigned int& csr = getCSRegister(instruction[3]);
-				gpr = csr;
-			}
-			if (instruction[1] == '1')
-			{
-				unsigned int& gpr1 = getGPRegister(instruction[2]);
-				unsigned int& gpr2 = getGPRegister(instruction[3]);
-				unsigned int disp = getIntValueFromHex(instruction.substr(5));
-				gpr1 = gpr2 + disp;
-			}
-			if (instruction[1] == '2')
-			{
-				unsigned int& gpr1 = getGPRegister(instruction[2]);
-				unsigned int& gpr2 = getGPRegister(instruction[3]);
-				unsigned int& gpr3 = getGPRegister(instruction[4]);
-				unsigned int disp = getIntValueFromHex(instruction.substr(5));
+op_jmp:
+	gpr[PC] = gpr[op->a] + op->disp;
+	NEXT
+op_beq:
+	if (gpr[op->b] == gpr[op->c]) gpr[PC] = gpr[op->a] + op->disp;
+	NEXT
+op_bne:
+	if (gpr[op->b] != gpr[op->c]) gpr[PC] = gpr[op->a] + op->disp;
+	NEXT
+op_bgt:
+	if ((int)gpr[op->b] > (int)gpr[op->c]) gpr[PC] = gpr[op->a] + op->disp;
+	NEXT
+op_jmp_mem:
+	gpr[PC] = readWord(gpr[op->a] + op->disp);
+	NEXT
+op_beq_mem:
+	if (gpr[op->b] == gpr[op->c]) gpr[PC] = readWord(gpr[op->a] + op->disp);
+	NEXT
+op_bne_mem:
+	if (gpr[op->b] != gpr[op->c]) gpr[PC] = readWord(gpr[op->a] + op->disp);
+	NEXT
+op_bgt_mem:
+	if ((int)gpr[op->b] > (int)gpr[op->c]) gpr[PC] = readWord(gpr[op->a] + op->disp);
+	NEXT
 
-				if (instruction[4] == '1')
-				{
-					unsigned int address = gpr2 + disp;
-					gpr1 = getIntValueFromHex(formatHexData(memory[address]));
-					pc += 4;
-				}
-				else
-				{
-					unsigned int address = gpr2 + gpr3 + disp;
-					gpr1 = getIntValueFromHex(formatHexData(memory[address]));
-				}
-			}
-			if (instruction[1] == '3')
-			{
-				unsigned int& gpr1 = getGPRegister(instruction[2]);
-				unsigned int& gpr2 = getGPRegister(instruction[3]);
-				unsigned int disp = getIntValueFromHex(instruction.substr(5));
-				
-				if (instruction[4] == '1')
-				{
-					unsigned int tempPC = getIntValueFromHex(formatHexData(memory[gpr2]));
-					gpr2 = gpr2 + disp;
-
-					instruction = memory[pc];
-					gpr1 = tempPC;
-
-					unsigned int& csr = getCSRegister(instruction[2]);
-					unsigned int& gpr = getGPRegister(instruction[3]);
-					disp = getIntValueFromHex(instruction.substr(5));
-					csr = getIntValueFromHex(formatHexData(memory[gpr]));
-					gpr = gpr + disp;
-					continue;
-				}
-				else
-				{
-					gpr1 = getIntValueFromHex(formatHexData(memory[gpr2]));
-					gpr2 = gpr2 + disp;
-				}
-			}
-			if (instruction[1] == '4')
-			{
-				unsigned int& csr = getCSRegister(instruction[2]);
-				unsigned int& gpr = getGPRegister(instruction[3]);
-				csr = gpr;
-			}
-			if (instruction[1] == '5')
-			{
-				unsigned int& csr1 = getCSRegister(instruction[2]);
-				unsigned int& csr2 = getGPRegister(instruction[3]);
-				unsigned int disp = getIntValueFromHex(instruction.substr(5));
-				csr1 = csr2 + disp;
-			}
-			if (instruction[1] == '6')
-			{
-				unsigned int& csr = getCSRegister(instruction[2]);
-				unsigned int& gpr1 = getGPRegister(instruction[3]);
-				unsigned int& gpr2 = getGPRegister(instruction[4]);
-				unsigned int disp = getIntValueFromHex(instruction.substr(5));
+op_xchg:
+{
+	unsigned int temp = gpr[op->b];
+	gpr[op->b] = gpr[op->c];
+	gpr[op->c] = temp;
+	gpr[0] = 0;
+	NEXT
+}
 
-				if (&gpr1 == &gpr2)
-				{
-					unsigned int address = gpr1 + disp;
-					csr = getIntValueFromHex(formatHexData(memory[address]));
-					pc += 4;
-				}
-				else
-				{
-					unsigned int address = gpr1 + gpr2 + disp;
-					csr = getIntValueFromHex(formatHexData(memory[address]));
-				}
-			}
-			if (instruction[1] == '7')
-			{
-				unsigned int& csr = getCSRegister(instruction[2]);
-				unsigned int& gpr = getGPRegister(instruction[3]);
-				unsigned int disp = getIntValueFromHex(instruction.substr(5));
-				csr = getIntValueFromHex(formatHexData(memory[gpr]));
-				gpr = gpr + disp;
-			}
-		}
+op_add:
+	gpr[op->a] = gpr[op->b] + gpr[op->c];
+	NEXT
+op_sub:
+	gpr[op->a] = gpr[op->b] - gpr[op->c];
+	NEXT
+op_mul:
+	gpr[op->a] = gpr[op->b] * gpr[op->c];
+	NEXT
+op_div:
+	gpr[op->a] = gpr[op->b] / gpr[op->c];
+	NEXT
+
+op_not:
+	gpr[op->a] = ~gpr[op->b];
+	NEXT
+op_and:
+	gpr[op->a] = gpr[op->b] & gpr[op->c];
+	NEXT
+op_or:
+	gpr[op->a] = gpr[op->b] | gpr[op->c];
+	NEXT
+op_xor:
+	gpr[op->a] = gpr[op->b] ^ gpr[op->c];
+	NEXT
+
+op_shl:
+	gpr[op->a] = gpr[op->b] << gpr[op->c];
+	NEXT
+op_shr:
+	gpr[op->a] = gpr[op->b] >> gpr[op->c];
+	NEXT
+
+op_st:
+	writeWord(gpr[op->a] + gpr[op->b] + op->disp, gpr[op->c]);
+	STORE_NEXT
+op_push:
+	gpr[op->a] = gpr[op->a] + op->disp;
+	writeWord(gpr[op->a], gpr[op->c]);
+	gpr[0] = 0;
+	STORE_NEXT
+op_st_mem:
+{
+	unsigned int address = readWord(gpr[op->a] + gpr[op->b] + op->disp);
+	writeWord(address, gpr[op->c]);
+	STORE_NEXT
+}
+
+op_csrrd:
+	gpr[op->a] = csr[op->b];
+	NEXT
+op_ld_reg:
+	gpr[op->a] = gpr[op->b] + op->disp;
+	NEXT
+op_ld_mem:
+	gpr[op->a] = readWord(gpr[op->b] + gpr[op->c] + op->disp);
+	NEXT
+op_pop:
+	if (op->c == 0x1)
+	{
+		// IRET: pop pc, then execute the following pop status in place
+		unsigned int tempPC = readWord(gpr[op->b]);
+		gpr[op->b] = gpr[op->b] + op->disp;
+
+		DecodedInstruction next = decodeInstruction(readWord(gpr[PC]));
+		gpr[op->a] = tempPC;
+
+		csr[next.a] = readWord(gpr[next.b]);
+		gpr[next.b] = gpr[next.b] + next.disp;
+		recheckInterrupts();
 	}
+	else
+	{
+		gpr[op->a] = readWord(gpr[op->b]);
+		gpr[op->b] = gpr[op->b] + op->disp;
+	}
+	gpr[0] = 0;
+	NEXT
+op_csrwr:
+	csr[op->a] = gpr[op->b];
+	recheckInterrupts();
+	NEXT
+op_csr_add:
+	csr[op->a] = gpr[op->b] + op->disp;
+	recheckInterrupts();
+	NEXT
+op_csr_mem:
+	csr[op->a] = readWord(gpr[op->b] + gpr[op->c] + op->disp);
+	recheckInterrupts();
+	NEXT
+op_csr_pop:
+	csr[op->a] = readWord(gpr[op->b]);
+	gpr[op->b] = gpr[op->b] + op->disp;
+	gpr[0] = 0;
+	recheckInterrupts();
+	NEXT
+
+op_nop:
+	NEXT
 
+#undef NEXT
+#undef STORE_NEXT
 }
 
 void Emulator::outputFinalState()
 {
 	cout << "\n   -----------------------------------------------------------------\n   ";
 	cout << "Emulated processor executed halt instruction\n   ";
-	cout << "Emulated processor state:\n   ";
-	cout << setw(6) << setfill(' ') << right << "r0=0x";
-	cout << setw(8) << setfill('0') << hex << uppercase << r0 << "   ";
-	cout << setw(6) << setfill(' ') << right << "r1=0x";
-	cout << setw(8) << setfill('0') << hex << uppercase << r1 << "   ";
-	cout << setw(6) << setfill(' ') << right << "r2=0x";
-	cout << setw(8) << setfill('0') << hex << uppercase << r2 << "   ";
-	cout << setw(6) << setfill(' ') << right << "r3=0x";
-	cout << setw(8) << setfill('0') << hex << uppercase << r3 << "\n   ";
-	cout << setw(6) << setfill(' ') << right << "r4=0x";
-	cout << setw(8) << setfill('0') << hex << uppercase << r4 << "   ";
-	cout << setw(6) << setfill(' ') << right << "r5=0x";
-	cout << setw(8) << setfill('0') << hex << uppercase << r5 << "   ";
-	cout << setw(6) << setfill(' ') << right << "r6=0x";
-	cout << setw(8) << setfill('0') << hex << uppercase << r6 << "   ";
-	cout << setw(6) << setfill(' ') << right << "r7=0x";
-	cout << setw(8) << setfill('0') << hex << uppercase << r7 << "\n   ";
-	cout << setw(6) << setfill(' ') << right << "r8=0x";
-	cout << setw(8) << setfill('0') << hex << uppercase << r8 << "   ";
-	cout << setw(6) << setfill(' ') << right << "r9=0x";
-	cout << setw(8) << setfill('0') << hex << uppercase << r9 << "   ";
-	cout << setw(6) << setfill(' ') << right << "r10=0x";
-	cout << setw(8) << setfill('0') << hex << uppercase << r10 << "   ";
-	cout << setw(6) << setfill(' ') << right << "r11=0x";
-	cout << setw(8) << setfill('0') << hex << uppercase << r11 << "\n   ";
-	cout << setw(6) << setfill(' ') << right << "r12=0x";
-	cout << setw(8) << setfill('0') << hex << uppercase << r12 << "   ";
-	cout << setw(6) << setfill(' ') << right << "r13=0x";
-	cout << setw(8) << setfill('0') << hex << uppercase << r13 << "   ";
-	cout << setw(6) << setfill(' ') << right << "r14=0x";
-	cout << setw(8) << setfill('0') << hex << uppercase << r14 << "   ";
-	cout << setw(6) << setfill(' ') << right << "r15=0x";
-	cout << setw(8) << setfill('0') << hex << uppercase << r15 << "\n";
+	cout << "Emulated processor state:";
+	for (int i = 0; i < GPR_COUNT; i++)
+	{
+		cout << ((i % 4 == 0) ? "\n   " : "   ");
+		cout << setw(6) << setfill(' ') << right << ("r" + to_string(i) + "=0x");
+		cout << setw(8) << setfill('0') << hex << uppercase << gpr[i];
+	}
+	cout << "\n";
 }
 
 void Emulator::executeHexProgeam()
 {
 	loadProgramInMemory();
 	executeInstructions();
+	flushTerminal();
+	restoreTerminal();
 	outputFinalState();
 }
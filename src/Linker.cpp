@@ -1,16 +1,17 @@
 #include "Linker.h"
 
-Linker::Linker(string outputFile, vector<string> inputFileList, map<string, string> placeSection)
+Linker::Linker(string outputFile, vector<string> inputFileList, map<string, string> placeSection, bool binaryOutput, unsigned int threadCount, bool incremental)
 {
 	outputFileName = outputFile;
+	this->binaryOutput = binaryOutput;
+	this->incremental = incremental;
+	this->threadCount = (threadCount == 0) ? 1 : threadCount;
 	objectFileNames = inputFileList;
 	placeSectionMap = placeSection;
 	objFileDataList = nullptr;
 	objFileDataListTail = nullptr;
 	shdr = nullptr;
 	shdrTail = nullptr;
-	symtab = nullptr;
-	symtabTail = nullptr;
 	linkerInfo.open("linkerInfo.txt");
 }
 
@@ -23,10 +24,6 @@ Linker::~Linker()
 	deleteSectionHeaderList();
 	shdr = nullptr;
 	shdrTail = nullptr;
-
-	deleteSymbolTableList();
-	symtab = nullptr;
-	symtabTail = nullptr;
 }
 
 void Linker::deleteObjectFileDataList()
@@ -40,7 +37,7 @@ void Linker::deleteObjectFileDataList()
 	}
 }
 
-void Linker::addNewSectionHeaderEntry(unsigned int address, unsigned int size, string name)
+void Linker::addNewSectionHeaderEntry(unsigned int address, unsigned int size, Atom name)
 {
 	SectionHeaderList* newElem = new SectionHeaderList();
 	newElem->next = nullptr;
@@ -64,74 +61,107 @@ void Linker::deleteSectionHeaderList()
 	}
 }
 
-void Linker::printSectionHeader(ostream& os)
+vector<Linker::SectionHeaderEntry*> Linker::getSectionsByAddress()
 {
-	os << "\nADDRESS       SIZE          SECTION\n";
+	vector<SectionHeaderEntry*> sections;
 	for (SectionHeaderList* cur = shdr; cur != nullptr; cur = cur->next)
 	{
-		os << uppercase << hex << setw(8) << setfill('0') << cur->entry.address << "      ";
-		os << uppercase << hex << setw(8) << setfill('0') << cur->entry.size << "      ";
-		os << cur->entry.name << endl;
+		sections.push_back(&cur->entry);
 	}
+	stable_sort(sections.begin(), sections.end(), [](SectionHeaderEntry* a, SectionHeaderEntry* b)
+	{
+		return a->address < b->address;
+	});
+	return sections;
 }
 
-void Linker::addNewSymbolTableEntry(int id, string name, unsigned int value, string type, int sectionId, string binding)
+Linker::WordCursor::WordCursor(vector<SectionHeaderEntry*> sections)
 {
-	SymbolTableList* newElem = new SymbolTableList();
-	newElem->next = nullptr;
-	newElem->entry.id = id;
-	newElem->entry.name = name;
-	newElem->entry.value = value;
-	newElem->entry.type = type;
-	newElem->entry.sectionId = sectionId;
-	newElem->entry.binding = binding;
-
-	if (symtab == nullptr) symtab = newElem;
-	else symtabTail->next = newElem;
-	symtabTail = newElem;
+	this->sections = sections;
 }
 
-int Linker::getSymbolID(string symbol)
+bool Linker::WordCursor::next()
 {
-	for (SymbolTableList* cur = symtab; cur != nullptr; cur = cur->next)
+	while (section < sections.size())
 	{
-		if (cur->entry.name == symbol) return cur->entry.id;
+		SectionHeaderEntry* cur = sections[section];
+		if (part < cur->parts.size())
+		{
+			unsigned int partEnd = (part + 1 < cur->parts.size()) ? cur->parts[part + 1] : cur->size;
+			if (offset < partEnd)
+			{
+				address = cur->address + offset;
+				size = min(4u, partEnd - offset);
+				bytes = cur->bytes.data() + offset;
+				while ((relocation < cur->relocations.size()) && (cur->relocations[relocation] < offset)) relocation++;
+				relocated = (relocation < cur->relocations.size()) && (cur->relocations[relocation] == offset);
+				offset += size;
+				return true;
+			}
+			part++;
+			if (part < cur->parts.size()) offset = cur->parts[part];
+			continue;
+		}
+		section++;
+		part = 0;
+		offset = 0;
+		relocation = 0;
 	}
-	return -1;
+	return false;
 }
 
-unsigned int Linker::getSymbolValue(string symbol)
+void Linker::printSectionHeader(ostream& os)
 {
-	for (SymbolTableList* cur = symtab; cur != nullptr; cur = cur->next)
+	os << "\nADDRESS       SIZE          SECTION\n";
+	for (SectionHeaderList* cur = shdr; cur != nullptr; cur = cur->next)
 	{
-		if (cur->entry.name == symbol) return cur->entry.value;
+		os << uppercase << hex << setw(8) << setfill('0') << cur->entry.address << "      ";
+		os << uppercase << hex << setw(8) << setfill('0') << cur->entry.size << "      ";
+		os << StringInterner::name(cur->entry.name) << endl;
 	}
-	return 0;
 }
 
-void Linker::deleteSymbolTableList()
+void Linker::addNewSymbolTableEntry(int id, Atom name, unsigned int value, ObjectSymbolType type, int sectionId, ObjectSymbolBinding binding)
 {
-	SymbolTableList* cur;
-	while (symtab)
-	{
-		cur = symtab;
-		symtab = symtab->next;
-		delete cur;
-	}
+	SymbolTableEntry newElem;
+	newElem.id = id;
+	newElem.name = name;
+	newElem.value = value;
+	newElem.type = type;
+	newElem.sectionId = sectionId;
+	newElem.binding = binding;
+
+	symtabIndex.emplace(name, symtab.size());
+	symtab.push_back(newElem);
+}
+
+int Linker::getSymbolID(Atom symbol)
+{
+	unordered_map<Atom, int>::iterator it = symtabIndex.find(symbol);
+	if (it != symtabIndex.end()) return symtab[it->second].id;
+	return -1;
+}
+
+unsigned int Linker::getSymbolValue(Atom symbol)
+{
+	unordered_map<Atom, int>::iterator it = symtabIndex.find(symbol);
+	if (it != symtabIndex.end()) return symtab[it->second].value;
+	return 0;
 }
 
 void Linker::printSymbolTable(ostream& os)
 {
 	os << "\nID  VALUE        TYPE      BINDING   SECTION   NAME\n";
-	for (SymbolTableList* cur = symtab; cur != nullptr; cur = cur->next)
+	for (size_t i = 0; i < symtab.size(); i++)
 	{
-		os << left << dec << setw(4) << setfill(' ') << cur->entry.id;
-		os << uppercase << setw(8) << setfill('0') << hex << cur->entry.value << "     ";
-		os << setw(10) << setfill(' ') << cur->entry.type;
-		os << setw(10) << setfill(' ') << cur->entry.binding;
-		if (cur->entry.sectionId == 0) os << dec << setw(10) << setfill(' ') << "UND";
-		else os << setw(10) << setfill(' ') << cur->entry.sectionId;
-		os << cur->entry.name << endl;
+		SymbolTableEntry& entry = symtab[i];
+		os << left << dec << setw(4) << setfill(' ') << entry.id;
+		os << uppercase << setw(8) << setfill('0') << hex << entry.value << "     ";
+		os << setw(10) << setfill(' ') << getSymbolTypeName(entry.type);
+		os << setw(10) << setfill(' ') << getSymbolBindingName(entry.binding);
+		if (entry.sectionId == 0) os << dec << setw(10) << setfill(' ') << "UND";
+		else os << setw(10) << setfill(' ') << entry.sectionId;
+		os << StringInterner::name(entry.name) << endl;
 	}
 }
 
@@ -143,20 +173,6 @@ int Linker::hexToInt(char c)
 	else return -1;
 }
 
-string Linker::formatHexData(unsigned int value)
-{
-	stringstream ss;
-	ss << uppercase << hex << setw(8) << setfill('0') << value;
-	string hex = ss.str();
-	string ret = "";
-	for (int i = 7; i > 0; i -= 2)
-	{
-		ret += hex[i - 1];
-		ret += hex[i];
-	}
-	return ret;
-}
-
 unsigned int Linker::getAddressValue(string hex)
 {
 	hex = "00000000" + hex.substr(2);
@@ -168,6 +184,9 @@ unsigned int Linker::getAddressValue(string hex)
 
 void Linker::errorMessage(string msg)
 {
+	// Object files are read in parallel, only the first error is reported
+	static mutex errorMutex;
+	errorMutex.lock();
 	cerr << msg << endl;
 	exit(1);
 }
@@ -198,7 +217,9 @@ void Linker::insertData(ObjectFileData& data, ifstream& file)
 				i++;
 				while ((line[i] != '|') && (i < line.length())) section += line[i++];
 
-				data.sectionTable[section] = value;
+				Atom name = StringInterner::intern(section);
+				data.sections.push_back(name);
+				data.sectionTable[name] = value;
 				getline(file, line);
 			}
 			continue;
@@ -212,6 +233,8 @@ void Linker::insertData(ObjectFileData& data, ifstream& file)
 			{
 				line = regex_replace(line, whitespace, "|");
 				SymbolTableEntry symbol;
+				string type = "";
+				string binding = "";
 				string section = "";
 				string name = "";
 				int i = 0;
@@ -219,19 +242,24 @@ void Linker::insertData(ObjectFileData& data, ifstream& file)
 				i++;
 				while ((line[i] != '|') && (i < line.length())) symbol.value = symbol.value * 16 + hexToInt(line[i++]);
 				i++;
-				while ((line[i] != '|') && (i < line.length())) symbol.type += line[i++];
+				while ((line[i] != '|') && (i < line.length())) type += line[i++];
 				i++;
-				while ((line[i] != '|') && (i < line.length())) symbol.binding += line[i++];
+				while ((line[i] != '|') && (i < line.length())) binding += line[i++];
 				i++;
+				symbol.type = (type == "SECTION") ? STT_SECTION : STT_NOTYPE;
+				if (binding == "LOCAL") symbol.binding = STB_LOCAL;
+				else if (binding == "GLOBAL") symbol.binding = STB_GLOBAL;
+				else if (binding == "EXTERN") symbol.binding = STB_EXTERN;
+				else symbol.binding = STB_UNDEFINED;
 				while ((line[i] != '|') && (i < line.length())) section += line[i++];
 				if (section == "UND") symbol.sectionId = 0;
 				else symbol.sectionId = stoi(section);
 				i++;
 				while ((line[i] != '|') && (i < line.length())) name += line[i++];
 				if (name.length() == 0) name = "UNDEFINED";
-				symbol.name = name;
+				symbol.name = StringInterner::intern(name);
 
-				data.symbolTable[name] = symbol;
+				data.symbolTable[symbol.name] = symbol;
 				getline(file, line);
 			}
 			continue;
@@ -240,7 +268,7 @@ void Linker::insertData(ObjectFileData& data, ifstream& file)
 		if (regex_search(line, relocation))
 		{
 			string section = regex_replace(line, relocation, "");
-			map<unsigned int, RelocationTableEntry> relocationTable;
+			vector<RelocationTableEntry> relocationTable;
 
 			getline(file, line);
 			getline(file, line);
@@ -248,27 +276,32 @@ void Linker::insertData(ObjectFileData& data, ifstream& file)
 			{
 				line = regex_replace(line, whitespace, "|");
 				RelocationTableEntry reldata;
+				string type = "";
+				string symbol = "";
 				int i = 0;
 				while ((line[i] != '|') && (i < line.length())) reldata.offset = reldata.offset * 16 + hexToInt(line[i++]);
 				i++;
-				while ((line[i] != '|') && (i < line.length())) reldata.type += line[i++];
+				while ((line[i] != '|') && (i < line.length())) type += line[i++];
 				i++;
-				while ((line[i] != '|') && (i < line.length())) reldata.symbol += line[i++];
+				while ((line[i] != '|') && (i < line.length())) symbol += line[i++];
 				i++;
 				while ((line[i] != '|') && (i < line.length())) reldata.addend = reldata.addend * 16 + hexToInt(line[i++]);
-				
-				relocationTable[reldata.offset] = reldata;
+				reldata.type = (type == "R_SEO_32") ? R_SEO_32 : R_ABS_32;
+				reldata.symbol = StringInterner::intern(symbol);
+
+				relocationTable.push_back(reldata);
 				getline(file, line);
 			}
 
-			data.sectionRelocationTable[section] = relocationTable;
+			sortRelocationTable(relocationTable);
+			data.sectionRelocationTable[StringInterner::intern(section)].swap(relocationTable);
 			continue;
 		}
 
 		if (regex_search(line, sectionData))
 		{
 			string section = regex_replace(line, sectionData, "");
-			map<unsigned int, string> codeData;
+			vector<uint8_t> bytes;
 
 			getline(file, line);
 			while (line.length() != 0)
@@ -281,11 +314,16 @@ void Linker::insertData(ObjectFileData& data, ifstream& file)
 				i++;
 				while ((line[i] != ':') && (i < line.length())) code += line[i++];
 
-				codeData[offset] = code;
+				// Relocated words are listed as ???????? and left zero until patched
+				for (size_t k = 0; k + 1 < code.length(); k += 2)
+				{
+					if (offset + k / 2 >= bytes.size()) bytes.resize(offset + k / 2 + 1, 0);
+					if (code[k] != '?') bytes[offset + k / 2] = hexToInt(code[k]) * 16 + hexToInt(code[k + 1]);
+				}
 				getline(file, line);
 			}
 
-			data.sectionCodeData[section] = codeData;
+			data.sectionData[StringInterner::intern(section)] = bytes;
 			continue;
 		}
 
@@ -293,13 +331,122 @@ void Linker::insertData(ObjectFileData& data, ifstream& file)
 	}
 }
 
-void Linker::printHexCode(ostream& os)
+bool Linker::readBinaryObjectFile(ObjectFileData& data, string fileName)
+{
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		errorMessage("Error: Error in opening file '" + fileName + "'!");
+	}
+
+	struct stat fileStat;
+	if ((fstat(fd, &fileStat) != 0) || (fileStat.st_size < (off_t)sizeof(ObjectFileHeader)))
+	{
+		close(fd);
+		return false;
+	}
+
+	size_t size = fileStat.st_size;
+	void* image = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (image == MAP_FAILED)
+	{
+		errorMessage("Error: Error in opening file '" + fileName + "'!");
+	}
+
+	bool binary = (((const ObjectFileHeader*)image)->magic == OBJ_MAGIC);
+	if (binary)
+	{
+		insertBinaryData(data, (const char*)image, size, fileName);
+	}
+	munmap(image, size);
+	return binary;
+}
+
+void Linker::insertBinaryData(ObjectFileData& data, const char* image, size_t size, string fileName)
+{
+	const ObjectFileHeader* header = (const ObjectFileHeader*)image;
+	if ((header->version != OBJ_VERSION) ||
+		(header->sectionTableOffset + (size_t)header->sectionCount * sizeof(ObjectSection) > size) ||
+		(header->symbolTableOffset + (size_t)header->symbolCount * sizeof(ObjectSymbol) > size) ||
+		(header->relocationTableOffset + (size_t)header->relocationCount * sizeof(ObjectRelocation) > size) ||
+		(header->stringTableSize == 0) ||
+		(header->stringTableOffset + (size_t)header->stringTableSize > size) ||
+		(image[header->stringTableOffset + header->stringTableSize - 1] != '\0'))
+	{
+		errorMessage("Error: Object file '" + fileName + "' is corrupted!");
+	}
+
+	const ObjectSection* sections = (const ObjectSection*)(image + header->sectionTableOffset);
+	const ObjectSymbol* symbols = (const ObjectSymbol*)(image + header->symbolTableOffset);
+	const ObjectRelocation* relocations = (const ObjectRelocation*)(image + header->relocationTableOffset);
+	const char* strtab = image + header->stringTableOffset;
+
+	for (uint32_t i = 0; i < header->symbolCount; i++)
+	{
+		if (symbols[i].name >= header->stringTableSize)
+		{
+			errorMessage("Error: Object file '" + fileName + "' is corrupted!");
+		}
+		SymbolTableEntry symbol;
+		symbol.id = symbols[i].id;
+		symbol.value = symbols[i].value;
+		symbol.type = (symbols[i].type == OBJ_SYM_SECTION) ? STT_SECTION : STT_NOTYPE;
+		if (symbols[i].binding == OBJ_BIND_LOCAL) symbol.binding = STB_LOCAL;
+		else if (symbols[i].binding == OBJ_BIND_GLOBAL) symbol.binding = STB_GLOBAL;
+		else if (symbols[i].binding == OBJ_BIND_EXTERN) symbol.binding = STB_EXTERN;
+		else symbol.binding = STB_UNDEFINED;
+		symbol.sectionId = symbols[i].sectionId;
+		symbol.name = StringInterner::intern((strtab[symbols[i].name] == '\0') ? "UNDEFINED" : strtab + symbols[i].name);
+
+		data.symbolTable[symbol.name] = symbol;
+	}
+
+	for (uint32_t i = 0; i < header->sectionCount; i++)
+	{
+		const ObjectSection& section = sections[i];
+		if ((section.name >= header->stringTableSize) ||
+			(section.dataOffset + (size_t)section.size > size) ||
+			((size_t)section.relocationIndex + section.relocationCount > header->relocationCount))
+		{
+			errorMessage("Error: Object file '" + fileName + "' is corrupted!");
+		}
+		Atom name = StringInterner::intern(strtab + section.name);
+		data.sections.push_back(name);
+		data.sectionTable[name] = section.size;
+
+		vector<RelocationTableEntry>& relocationTable = data.sectionRelocationTable[name];
+		relocationTable.reserve(section.relocationCount);
+		for (uint32_t j = section.relocationIndex; j < section.relocationIndex + section.relocationCount; j++)
+		{
+			if (relocations[j].symbol >= header->stringTableSize)
+			{
+				errorMessage("Error: Object file '" + fileName + "' is corrupted!");
+			}
+			RelocationTableEntry reldata;
+			reldata.offset = relocations[j].offset;
+			reldata.type = (relocations[j].type == OBJ_REL_SEO_32) ? R_SEO_32 : R_ABS_32;
+			reldata.symbol = StringInterner::intern(strtab + relocations[j].symbol);
+			reldata.addend = relocations[j].addend;
+			relocationTable.push_back(reldata);
+		}
+		sortRelocationTable(relocationTable);
+
+		const uint8_t* bytes = (const uint8_t*)(image + section.dataOffset);
+		data.sectionData[name].assign(bytes, bytes + section.size);
+	}
+}
+
+void Linker::printHexCode(ostream& os, bool patched)
 {
 	os << endl;
-	for (map<unsigned int, string>::iterator it = outputHexCode.begin(); it != outputHexCode.end(); it++)
+	WordCursor word(getSectionsByAddress());
+	while (word.next())
 	{
-		os << uppercase << hex << setw(8) << setfill('0') << it->first;
-		os << ":   " << it->second << endl;
+		os << uppercase << hex << setw(8) << setfill('0') << word.address << ":   ";
+		if (!patched && word.relocated) os << "????????";
+		else for (unsigned int i = 0; i < word.size; i++) os << setw(2) << (unsigned int)word.bytes[i];
+		os << endl;
 	}
 }
 
@@ -307,23 +454,39 @@ void Linker::printRelocationTable(ostream& os)
 {
 	for (ObjectFileDataList* cur = objFileDataList; cur != nullptr; cur = cur->next)
 	{
-		map<string, map<unsigned int, RelocationTableEntry>>::iterator it;
-		for (it = cur->data.sectionRelocationTable.begin(); it != cur->data.sectionRelocationTable.end(); it++)
+		for (size_t i = 0; i < cur->data.sections.size(); i++)
 		{
-			if (it->second.size() == 0) continue;
-			os << "\nRelocation_record: " + cur->name + "#" + it->first;
+			unordered_map<Atom, vector<RelocationTableEntry>>::iterator it = cur->data.sectionRelocationTable.find(cur->data.sections[i]);
+			if ((it == cur->data.sectionRelocationTable.end()) || (it->second.size() == 0)) continue;
+			os << "\nRelocation_record: " + cur->name + "#" + StringInterner::name(it->first);
 			os << "\nOFFSET      TYPE        SYMBOL          ADDEND\n";
-			for (map<unsigned int, RelocationTableEntry>::iterator it2 = it->second.begin(); it2 != it->second.end(); it2++)
+			for (vector<RelocationTableEntry>::iterator it2 = it->second.begin(); it2 != it->second.end(); it2++)
 			{
-				os << left << hex << setw(8) << setfill('0') << it2->second.offset << "    ";
-				os << setw(12) << setfill(' ') << it2->second.type;
-				os << setw(16) << setfill(' ') << it2->second.symbol;
-				os << right << hex << setw(8) << setfill('0') << it2->second.addend << endl;
+				os << left << hex << setw(8) << setfill('0') << it2->offset << "    ";
+				os << setw(12) << setfill(' ') << getRelocationTypeName(it2->type);
+				os << setw(16) << setfill(' ') << StringInterner::name(it2->symbol);
+				os << right << hex << setw(8) << setfill('0') << it2->addend << endl;
 			}
 		}
 	}
 }
 
+void Linker::sortRelocationTable(vector<RelocationTableEntry>& table)
+{
+	// Records come in file order, a later record for the same offset replaces an earlier one
+	if (!is_sorted(table.begin(), table.end(), [](const RelocationTableEntry& a, const RelocationTableEntry& b) { return a.offset < b.offset; }))
+	{
+		stable_sort(table.begin(), table.end(), [](const RelocationTableEntry& a, const RelocationTableEntry& b) { return a.offset < b.offset; });
+	}
+	size_t kept = 0;
+	for (size_t i = 0; i < table.size(); i++)
+	{
+		if ((i + 1 < table.size()) && (table[i + 1].offset == table[i].offset)) continue;
+		table[kept++] = table[i];
+	}
+	table.resize(kept);
+}
+
 void Linker::checkAddressOverflow(unsigned int base, unsigned int offset)
 {
 	unsigned long long address = (unsigned long long)base + offset;
@@ -333,38 +496,70 @@ void Linker::checkAddressOverflow(unsigned int base, unsigned int offset)
 	}
 }
 
-void Linker::readObjectFiles()
+void Linker::readObjectFile(ObjectFileDataList* objFile)
 {
-	for (int i = 0; i < objectFileNames.size(); i++)
+	if (incremental) objFile->hash = hashObjectFile(objFile->name);
+
+	// Binary objects are mapped and read in place, anything else is parsed as the text dump
+	if (!readBinaryObjectFile(objFile->data, objFile->name))
 	{
-		ifstream inputFile(objectFileNames[i]);
+		ifstream inputFile(objFile->name);
 		if (inputFile.is_open())
 		{
-			ObjectFileDataList* newElem = new ObjectFileDataList();
-			newElem->name = objectFileNames[i];
-			newElem->next = nullptr;
-			insertData(newElem->data, inputFile);
-
-			if (objFileDataList == nullptr) objFileDataList = newElem;
-			else objFileDataListTail->next = newElem;
-			objFileDataListTail = newElem;
+			insertData(objFile->data, inputFile);
 		}
 		else
 		{
-			errorMessage("Error: Error in opening file '" + objectFileNames[i] + "'!");
+			errorMessage("Error: Error in opening file '" + objFile->name + "'!");
 		}
 	}
 }
 
+void Linker::readObjectFiles()
+{
+	// The list is built in command-line order first, so every later pass sees
+	// the files in the same order no matter which worker read them
+	vector<ObjectFileDataList*> objFiles;
+	for (size_t i = 0; i < objectFileNames.size(); i++)
+	{
+		ObjectFileDataList* newElem = new ObjectFileDataList();
+		newElem->name = objectFileNames[i];
+		newElem->next = nullptr;
+		objFiles.push_back(newElem);
+
+		if (objFileDataList == nullptr) objFileDataList = newElem;
+		else objFileDataListTail->next = newElem;
+		objFileDataListTail = newElem;
+	}
+
+	// Each worker fills only the ObjectFileData of the files it takes
+	atomic<size_t> next(0);
+	vector<thread> workers;
+	for (unsigned int t = 0; (t < threadCount) && (t < objFiles.size()); t++)
+	{
+		workers.push_back(thread([&]()
+		{
+			for (size_t i = next++; i < objFiles.size(); i = next++)
+			{
+				readObjectFile(objFiles[i]);
+			}
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
+	}
+}
+
 void Linker::checkSymbolsForError()
 {
-	map<string, bool> checked;
+	unordered_map<Atom, bool> checked;
 	for (ObjectFileDataList* objFile = objFileDataList; objFile != nullptr; objFile = objFile->next)
 	{
-		map<string, SymbolTableEntry>::iterator entry;
+		unordered_map<Atom, SymbolTableEntry>::iterator entry;
 		for (entry = objFile->data.symbolTable.begin(); entry != objFile->data.symbolTable.end(); entry++)
 		{
-			if (entry->second.binding == "GLOBAL")
+			if (entry->second.binding == STB_GLOBAL)
 			{
 				if (checked[entry->second.name] == false)
 				{
@@ -372,23 +567,23 @@ void Linker::checkSymbolsForError()
 				}
 				else
 				{
-					errorMessage("Error: Multiple definitions found for GLOBAL symbol '" + entry->second.name + "'!");
+					errorMessage("Error: Multiple definitions found for GLOBAL symbol '" + StringInterner::name(entry->second.name) + "'!");
 				}
 			}
 		}
 	}
 	for (ObjectFileDataList* objFile = objFileDataList; objFile != nullptr; objFile = objFile->next)
 	{
-		map<string, SymbolTableEntry>::iterator entry;
+		unordered_map<Atom, SymbolTableEntry>::iterator entry;
 		for (entry = objFile->data.symbolTable.begin(); entry != objFile->data.symbolTable.end(); entry++)
 		{
-			if ((entry->second.binding == "EXTERN") && (checked[entry->second.name] == false))
+			if ((entry->second.binding == STB_EXTERN) && (checked[entry->second.name] == false))
 			{
-				errorMessage("Error: Unresolved EXTERNAL symbol '" + entry->second.name + "'!");
+				errorMessage("Error: Unresolved EXTERNAL symbol '" + StringInterner::name(entry->second.name) + "'!");
 			}
-			if (entry->second.binding == "UNDEFINED")
+			if (entry->second.binding == STB_UNDEFINED)
 			{
-				errorMessage("Error: UNDEFINED symbol '" + entry->second.name + "'!");
+				errorMessage("Error: UNDEFINED symbol '" + StringInterner::name(entry->second.name) + "'!");
 			}
 		}
 	}
@@ -396,29 +591,29 @@ void Linker::checkSymbolsForError()
 
 void Linker::checkSectionsForOverlapping()
 {
-	map<string, bool> checked;
+	unordered_map<Atom, bool> checked;
 	unsigned int currentSectionSize = 0;
 	
 	unsigned int sectionEndAddress = 0;
-	string prevSection = "";
-	string currentSection = "";
+	Atom prevSection = 0;
+	Atom currentSection = 0;
 	bool flag = false;
 
 	map<string, string>::iterator it;
 	for (it = placeSectionMap.begin(); it != placeSectionMap.end(); it++)
 	{
 		unsigned int sectionBeginAddress = getAddressValue(it->first);
-		currentSection = it->second;
+		currentSection = StringInterner::intern(it->second);
 
 		if (checked[currentSection])
 		{
-			errorMessage("Error: Place agument called multiple times for section '" + currentSection + "'!");
+			errorMessage("Error: Place agument called multiple times for section '" + it->second + "'!");
 		}
 
 		bool sectionFound = false;
 		for (ObjectFileDataList* cur = objFileDataList; cur != nullptr; cur = cur->next)
 		{
-			map<string, unsigned int>::iterator sectionSize = cur->data.sectionTable.find(currentSection);
+			unordered_map<Atom, unsigned int>::iterator sectionSize = cur->data.sectionTable.find(currentSection);
 			if (sectionSize != cur->data.sectionTable.end())
 			{
 				sectionFound = true;
@@ -428,12 +623,12 @@ void Linker::checkSectionsForOverlapping()
 
 		if (sectionFound = false)
 		{
-			errorMessage("Error: Section '" + currentSection + "' does not exist!");
+			errorMessage("Error: Section '" + it->second + "' does not exist!");
 		}
 
 		if ((flag == true) && (sectionEndAddress > sectionBeginAddress))
 		{
-			errorMessage("Error: Section '" + currentSection + "' is overlapping with section '" + prevSection + "'!");
+			errorMessage("Error: Section '" + it->second + "' is overlapping with section '" + StringInterner::name(prevSection) + "'!");
 		}
 		flag = true;
 
@@ -449,11 +644,10 @@ void Linker::checkSectionsForOverlapping()
 
 	for (ObjectFileDataList* cur = objFileDataList; cur != nullptr; cur = cur->next)
 	{
-		map<string, unsigned int>::iterator section;
-		for (section = cur->data.sectionTable.begin(); section != cur->data.sectionTable.end(); section++)
+		for (size_t i = 0; i < cur->data.sections.size(); i++)
 		{
-			currentSection = section->first;
-			currentSectionSize = section->second;
+			currentSection = cur->data.sections[i];
+			currentSectionSize = cur->data.sectionTable[currentSection];
 
 			if (checked[currentSection]) continue;
 			checked[currentSection] = true;
@@ -462,7 +656,7 @@ void Linker::checkSectionsForOverlapping()
 
 			for (ObjectFileDataList* rest = cur->next; rest != nullptr; rest = rest->next)
 			{
-				map<string, unsigned int>::iterator sectionInDifferentFile = rest->data.sectionTable.find(currentSection);
+				unordered_map<Atom, unsigned int>::iterator sectionInDifferentFile = rest->data.sectionTable.find(currentSection);
 				if (sectionInDifferentFile != rest->data.sectionTable.end())
 				{
 					currentSectionSize += sectionInDifferentFile->second;
@@ -479,23 +673,23 @@ void Linker::checkSectionsForOverlapping()
 
 void Linker::updateSymbolTable()
 {
-	addNewSymbolTableEntry(0, "", 0, "NOTYPE", 0, "LOCAL");
+	addNewSymbolTableEntry(0, StringInterner::intern(""), 0, STT_NOTYPE, 0, STB_LOCAL);
 
 	for (SectionHeaderList* cur = shdr; cur != nullptr; cur = cur->next)
 	{
-		string currentSection = cur->entry.name;
+		Atom currentSection = cur->entry.name;
 		unsigned int base = cur->entry.address;
 
-		addNewSymbolTableEntry(symtabTail->entry.id + 1, currentSection, base, "SECTION", symtabTail->entry.id + 1, "LOCAL");
+		addNewSymbolTableEntry(symtab.back().id + 1, currentSection, base, STT_SECTION, symtab.back().id + 1, STB_LOCAL);
 
 		for (ObjectFileDataList* objFile = objFileDataList; objFile != nullptr; objFile = objFile->next)
 		{
-			map<string, SymbolTableEntry>::iterator sectionEntry = objFile->data.symbolTable.find(currentSection);
+			unordered_map<Atom, SymbolTableEntry>::iterator sectionEntry = objFile->data.symbolTable.find(currentSection);
 			if (sectionEntry != objFile->data.symbolTable.end())
 			{
 				sectionEntry->second.value = base;
 				int sectionID = sectionEntry->second.id;
-				for (map<string, SymbolTableEntry>::iterator entry = objFile->data.symbolTable.begin(); entry != objFile->data.symbolTable.end(); entry++)
+				for (unordered_map<Atom, SymbolTableEntry>::iterator entry = objFile->data.symbolTable.begin(); entry != objFile->data.symbolTable.end(); entry++)
 				{
 					if ((entry->second.sectionId == sectionID) && (entry != sectionEntry))
 					{
@@ -509,12 +703,15 @@ void Linker::updateSymbolTable()
 
 	for (ObjectFileDataList* objFile = objFileDataList; objFile != nullptr; objFile = objFile->next)
 	{
-		map<int, string> sectionIdMap;
-		map<string, SymbolTableEntry>::iterator symbolTableEntry;
+		if (incremental) objFile->symbolSignature = getSymbolSignature(objFile->data);
+		objFile->symtabBegin = symtab.size();
+
+		map<int, Atom> sectionIdMap;
+		unordered_map<Atom, SymbolTableEntry>::iterator symbolTableEntry;
 		map<int, SymbolTableEntry> sortTable;
 		for (symbolTableEntry = objFile->data.symbolTable.begin(); symbolTableEntry != objFile->data.symbolTable.end(); symbolTableEntry++)
 		{
-			if (symbolTableEntry->second.type == "SECTION")
+			if (symbolTableEntry->second.type == STT_SECTION)
 			{
 				sectionIdMap[symbolTableEntry->second.id] = symbolTableEntry->second.name;
 			}
@@ -522,39 +719,40 @@ void Linker::updateSymbolTable()
 		}
 		for (map<int, SymbolTableEntry>::iterator entry = sortTable.begin(); entry != sortTable.end(); entry++)
 		{
-			if ((entry->second.type == "NOTYPE") && (entry->second.id != 0) && (entry->second.binding != "EXTERN"))
+			if ((entry->second.type == STT_NOTYPE) && (entry->second.id != 0) && (entry->second.binding != STB_EXTERN))
 			{
 				int sectionID = getSymbolID(sectionIdMap[entry->second.sectionId]);
-				addNewSymbolTableEntry(symtabTail->entry.id + 1, entry->second.name, entry->second.value, entry->second.type, sectionID, entry->second.binding);
+				addNewSymbolTableEntry(symtab.back().id + 1, entry->second.name, entry->second.value, entry->second.type, sectionID, entry->second.binding);
 			}
 		}
+		objFile->symtabCount = symtab.size() - objFile->symtabBegin;
 	}
 }
 
 void Linker::updateCodeAddresses()
 {
+	// Every placed section gets one buffer, the parts of the objects follow each other in it
 	for (SectionHeaderList* cur = shdr; cur != nullptr; cur = cur->next)
 	{
-		string currentSection = cur->entry.name;
-		unsigned int base = cur->entry.address;
-		unsigned int currentAddress = 0;
+		Atom currentSection = cur->entry.name;
+		unsigned int offset = 0;
+		cur->entry.bytes.assign(cur->entry.size, 0);
 
 		for (ObjectFileDataList* objFile = objFileDataList; objFile != nullptr; objFile = objFile->next)
 		{
-			map<string, map<unsigned int, string>>::iterator sectionCode = objFile->data.sectionCodeData.find(currentSection);
-			if (sectionCode != objFile->data.sectionCodeData.end())
-			{
-				map<unsigned int, string> updateCodeAddress;
-				for (map<unsigned int, string>::iterator code = sectionCode->second.begin(); code != sectionCode->second.end(); code++)
-				{
-					currentAddress = base + code->first;
-					updateCodeAddress[currentAddress] = code->second;
-					outputHexCode[currentAddress] = code->second;
-				}
+			unordered_map<Atom, unsigned int>::iterator sectionSize = objFile->data.sectionTable.find(currentSection);
+			if (sectionSize == objFile->data.sectionTable.end()) continue;
 
-				sectionCode->second = updateCodeAddress;
-				base = base + objFile->data.sectionTable[currentSection];
+			cur->entry.parts.push_back(offset);
+			objFile->partOffset[currentSection] = offset;
+			unordered_map<Atom, vector<uint8_t>>::iterator sectionCode = objFile->data.sectionData.find(currentSection);
+			if (sectionCode != objFile->data.sectionData.end())
+			{
+				size_t size = min((size_t)sectionSize->second, sectionCode->second.size());
+				if (size > 0) memcpy(cur->entry.bytes.data() + offset, sectionCode->second.data(), size);
+				vector<uint8_t>().swap(sectionCode->second);
 			}
+			offset += sectionSize->second;
 		}
 	}
 }
@@ -563,31 +761,29 @@ void Linker::updateRelocationTable()
 {
 	for (SectionHeaderList* cur = shdr; cur != nullptr; cur = cur->next)
 	{
-		string currentSection = cur->entry.name;
+		Atom currentSection = cur->entry.name;
 		unsigned int base = cur->entry.address;
 		unsigned int currentAddress = 0;
 		unsigned int addendOffset = 0;
 
 		for (ObjectFileDataList* objFile = objFileDataList; objFile != nullptr; objFile = objFile->next)
 		{
-			map<string, map<unsigned int, RelocationTableEntry>>::iterator relocRecord;
+			unordered_map<Atom, vector<RelocationTableEntry>>::iterator relocRecord;
 			relocRecord = objFile->data.sectionRelocationTable.find(currentSection);
 			if (relocRecord != objFile->data.sectionRelocationTable.end())
 			{
-				map<unsigned int, RelocationTableEntry> updateRelocationAddress;
-				for (map<unsigned int, RelocationTableEntry>::iterator record = relocRecord->second.begin(); record != relocRecord->second.end(); record++)
+				// Every offset moves by the same base, the table stays sorted
+				for (vector<RelocationTableEntry>::iterator record = relocRecord->second.begin(); record != relocRecord->second.end(); record++)
 				{
-					currentAddress = base + record->first;
-					record->second.offset = currentAddress;
-					if (record->second.type == "R_SEO_32")
+					currentAddress = base + record->offset;
+					record->offset = currentAddress;
+					if (record->type == R_SEO_32)
 					{
-						record->second.addend += addendOffset;
+						record->addend += addendOffset;
 					}
-					updateRelocationAddress[currentAddress] = record->second;
 				}
-				relocRecord->second = updateRelocationAddress;
 
-				map<string, unsigned int>::iterator sectionInDifferentFile = objFile->data.sectionTable.find(currentSection);
+				unordered_map<Atom, unsigned int>::iterator sectionInDifferentFile = objFile->data.sectionTable.find(currentSection);
 				if (sectionInDifferentFile != objFile->data.sectionTable.end())
 				{
 					base = base + sectionInDifferentFile->second;
@@ -598,57 +794,198 @@ void Linker::updateRelocationTable()
 	}
 }
 
+void Linker::collectSectionRelocations()
+{
+	for (SectionHeaderList* cur = shdr; cur != nullptr; cur = cur->next)
+	{
+		cur->entry.relocations.clear();
+		for (ObjectFileDataList* objFile = objFileDataList; objFile != nullptr; objFile = objFile->next)
+		{
+			unordered_map<Atom, vector<RelocationTableEntry>>::iterator relocRecord;
+			relocRecord = objFile->data.sectionRelocationTable.find(cur->entry.name);
+			if (relocRecord == objFile->data.sectionRelocationTable.end()) continue;
+
+			vector<RelocationTableEntry>::iterator record;
+			for (record = relocRecord->second.begin(); record != relocRecord->second.end(); record++)
+			{
+				cur->entry.relocations.push_back(record->offset - cur->entry.address);
+			}
+		}
+	}
+}
+
+void Linker::applyRelocations(const vector<RelocationPatch>& patches, size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; i++)
+	{
+		const RelocationTableEntry* record = patches[i].record;
+		unsigned int value = getSymbolValue(record->symbol);
+
+		if (record->type == R_SEO_32)
+		{
+			value += record->addend;
+		}
+
+		uint8_t* target = patches[i].target;
+		target[0] = value & 0xFF;
+		target[1] = (value >> 8) & 0xFF;
+		target[2] = (value >> 16) & 0xFF;
+		target[3] = (value >> 24) & 0xFF;
+	}
+}
+
 void Linker::rewriteRelocationData()
 {
-	for (ObjectFileDataList* cur = objFileDataList; cur != nullptr; cur = cur->next)
+	// Patches are gathered per output section in address order and cut into ranges,
+	// a worker only reads the symbol table and writes the words of its own range
+	vector<RelocationPatch> patches;
+	vector<pair<size_t, size_t>> ranges;
+	for (SectionHeaderList* cur = shdr; cur != nullptr; cur = cur->next)
 	{
-		map<string, map<unsigned int, RelocationTableEntry>>::iterator secRelTable;
-		for (secRelTable = cur->data.sectionRelocationTable.begin(); secRelTable != cur->data.sectionRelocationTable.end(); secRelTable++)
+		size_t sectionBegin = patches.size();
+		for (ObjectFileDataList* objFile = objFileDataList; objFile != nullptr; objFile = objFile->next)
 		{
-			map<unsigned int, RelocationTableEntry>::iterator relRecord;
-			for (relRecord = secRelTable->second.begin(); relRecord != secRelTable->second.end(); relRecord++)
+			unordered_map<Atom, vector<RelocationTableEntry>>::iterator relocRecord;
+			relocRecord = objFile->data.sectionRelocationTable.find(cur->entry.name);
+			if (relocRecord == objFile->data.sectionRelocationTable.end()) continue;
+
+			vector<RelocationTableEntry>::iterator record;
+			for (record = relocRecord->second.begin(); record != relocRecord->second.end(); record++)
 			{
-				unsigned int value = getSymbolValue(relRecord->second.symbol);
+				// An incremental link only patches changed files and uses of changed symbols
+				if (!objFile->changed && !changedSymbols.count(record->symbol)) continue;
 
-				if (relRecord->second.type == "R_SEO_32")
+				unsigned int offset = record->offset - cur->entry.address;
+				if ((record->offset < cur->entry.address) || ((unsigned long long)offset + 4 > cur->entry.size))
 				{
-					value += relRecord->second.addend;
+					errorMessage("Error: Relocation in section '" + StringInterner::name(cur->entry.name) + "' is outside of the section!");
 				}
-
-				outputHexCode[relRecord->second.offset] = formatHexData(value);
+				RelocationPatch patch;
+				patch.record = &*record;
+				patch.target = cur->entry.bytes.data() + offset;
+				patches.push_back(patch);
 			}
 		}
+		for (size_t begin = sectionBegin; begin < patches.size(); begin += PATCH_RANGE_SIZE)
+		{
+			ranges.push_back(make_pair(begin, min(begin + PATCH_RANGE_SIZE, patches.size())));
+		}
+	}
+
+	atomic<size_t> next(0);
+	vector<thread> workers;
+	for (unsigned int t = 0; (t < threadCount) && (t < ranges.size()); t++)
+	{
+		workers.push_back(thread([&]()
+		{
+			for (size_t i = next++; i < ranges.size(); i = next++)
+			{
+				applyRelocations(patches, ranges[i].first, ranges[i].second);
+			}
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
 	}
 }
 
 void Linker::createOutputFile()
 {
-	ofstream output(outputFileName);
+	if (binaryOutput) createImageOutputFile();
+	else createHexOutputFile();
+}
+
+void Linker::createImageOutputFile()
+{
+	// Sections that follow each other without a gap are merged into one segment
+	vector<SectionHeaderEntry*> sections = getSectionsByAddress();
+	vector<ImageSegment> segments;
+	unsigned int dataSize = 0;
+	unsigned int segmentEnd = 0;
+	for (size_t i = 0; i < sections.size(); i++)
+	{
+		if (sections[i]->size == 0) continue;
+		if (segments.empty() || (sections[i]->address != segmentEnd))
+		{
+			dataSize = (dataSize + 3) & ~3u;
+			ImageSegment segment;
+			segment.address = sections[i]->address;
+			segment.size = 0;
+			segment.dataOffset = dataSize;
+			segments.push_back(segment);
+			segmentEnd = sections[i]->address;
+		}
+		segments.back().size += sections[i]->size;
+		segmentEnd += sections[i]->size;
+		dataSize += sections[i]->size;
+	}
+
+	ImageFileHeader header;
+	header.magic = IMG_MAGIC;
+	header.version = IMG_VERSION;
+	header.segmentCount = segments.size();
+	header.segmentTableOffset = sizeof(ImageFileHeader);
+	unsigned int dataBegin = header.segmentTableOffset + segments.size() * sizeof(ImageSegment);
+	for (size_t i = 0; i < segments.size(); i++)
+	{
+		segments[i].dataOffset += dataBegin;
+	}
+
+	ofstream output(outputFileName, ios::binary);
 	if (output.is_open())
 	{
-		for (map<unsigned int, string>::iterator it = outputHexCode.begin(); it != outputHexCode.end(); it++)
+		output.write((const char*)&header, sizeof(header));
+		output.write((const char*)segments.data(), segments.size() * sizeof(ImageSegment));
+
+		const char padding[4] = { 0, 0, 0, 0 };
+		unsigned int written = 0;
+		size_t segment = 0;
+		for (size_t i = 0; i < sections.size(); i++)
 		{
-			output << uppercase << hex << setw(8) << setfill('0') << it->first;
-			output << ":  ";
-			for (int i = 0; i < 4; i++)
+			if (sections[i]->size == 0) continue;
+			if ((segment < segments.size()) && (sections[i]->address == segments[segment].address))
 			{
-				output << it->second[2 * i] << it->second[2 * i + 1] << "  ";
+				unsigned int begin = segments[segment].dataOffset - dataBegin;
+				output.write(padding, begin - written);
+				written = begin;
+				segment++;
 			}
-			unsigned int address1 = it->first;
-			it++;
-			if (it == outputHexCode.end()) break;
-			unsigned int address2 = it->first;
-			if (address2 - address1 != 4) 
+			output.write((const char*)sections[i]->bytes.data(), sections[i]->size);
+			written += sections[i]->size;
+		}
+	}
+	else
+	{
+		errorMessage("Error: Error in opening file '" + outputFileName + "'!");
+	}
+}
+
+void Linker::createHexOutputFile()
+{
+	ofstream output(outputFileName);
+	if (output.is_open())
+	{
+		// Two words per line when the second one directly follows the first
+		WordCursor word(getSectionsByAddress());
+		bool lineOpen = false;
+		unsigned int lineAddress = 0;
+		output << uppercase << hex << setfill('0');
+		while (word.next())
+		{
+			bool secondWord = lineOpen && (word.address - lineAddress == 4);
+			if (!secondWord)
 			{
-				output << '\n';
-				it--;
-				continue;
+				if (lineOpen) output << '\n';
+				output << setw(8) << word.address << ":  ";
+				lineAddress = word.address;
 			}
-			for (int i = 0; i < 4; i++)
+			for (unsigned int i = 0; i < word.size; i++)
 			{
-				output << it->second[2 * i] << it->second[2 * i + 1] << "  ";
+				output << setw(2) << (unsigned int)word.bytes[i] << "  ";
 			}
-			output << '\n';
+			if (secondWord) output << '\n';
+			lineOpen = !secondWord;
 		}
 	}
 	else
@@ -657,24 +994,451 @@ void Linker::createOutputFile()
 	}
 }
 
+static uint64_t hashBytes(const void* data, size_t size, uint64_t hash)
+{
+	// FNV-1a
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static void writeCacheWord(ostream& os, uint32_t word)
+{
+	os.write((const char*)&word, sizeof(word));
+}
+
+static void writeCacheHash(ostream& os, uint64_t hash)
+{
+	writeCacheWord(os, hash & 0xFFFFFFFF);
+	writeCacheWord(os, hash >> 32);
+}
+
+static void writeCacheBytes(ostream& os, const void* data, size_t size)
+{
+	const char padding[4] = { 0, 0, 0, 0 };
+	os.write((const char*)data, size);
+	os.write(padding, (4 - size % 4) % 4);
+}
+
+static void writeCacheString(ostream& os, const string& str)
+{
+	writeCacheWord(os, str.length());
+	writeCacheBytes(os, str.data(), str.length());
+}
+
+uint32_t Linker::CacheReader::word()
+{
+	if (failed || (position + 4 > data.size()))
+	{
+		failed = true;
+		return 0;
+	}
+	uint32_t word;
+	memcpy(&word, data.data() + position, sizeof(word));
+	position += 4;
+	return word;
+}
+
+uint64_t Linker::CacheReader::hash()
+{
+	uint64_t low = word();
+	uint64_t high = word();
+	return low | (high << 32);
+}
+
+string Linker::CacheReader::str()
+{
+	uint32_t length = word();
+	const uint8_t* chars = bytes(length);
+	if (chars == nullptr) return "";
+	return string((const char*)chars, length);
+}
+
+const uint8_t* Linker::CacheReader::bytes(size_t size)
+{
+	size_t padded = (size + 3) & ~(size_t)3;
+	if (failed || (padded > data.size() - position))
+	{
+		failed = true;
+		return nullptr;
+	}
+	const uint8_t* result = (const uint8_t*)data.data() + position;
+	position += padded;
+	return result;
+}
+
+uint64_t Linker::hashObjectFile(string fileName)
+{
+	ifstream file(fileName, ios::binary);
+	if (!file.is_open())
+	{
+		errorMessage("Error: Error in opening file '" + fileName + "'!");
+	}
+	uint64_t hash = 14695981039346656037ull;
+	char buffer[65536];
+	while (file.read(buffer, sizeof(buffer)) || (file.gcount() > 0))
+	{
+		hash = hashBytes(buffer, file.gcount(), hash);
+	}
+	return hash;
+}
+
+uint64_t Linker::getSymbolSignature(ObjectFileData& data)
+{
+	// Everything the symbol checks and the merged table depend on except the values
+	map<int, SymbolTableEntry> sortTable;
+	for (unordered_map<Atom, SymbolTableEntry>::iterator entry = data.symbolTable.begin(); entry != data.symbolTable.end(); entry++)
+	{
+		sortTable[entry->second.id] = entry->second;
+	}
+	uint64_t hash = 14695981039346656037ull;
+	for (map<int, SymbolTableEntry>::iterator entry = sortTable.begin(); entry != sortTable.end(); entry++)
+	{
+		const string& name = StringInterner::name(entry->second.name);
+		hash = hashBytes(&entry->second.id, sizeof(entry->second.id), hash);
+		hash = hashBytes(&entry->second.sectionId, sizeof(entry->second.sectionId), hash);
+		hash = hashBytes(name.c_str(), name.length() + 1, hash);
+		hash = hashBytes(&entry->second.type, sizeof(entry->second.type), hash);
+		hash = hashBytes(&entry->second.binding, sizeof(entry->second.binding), hash);
+	}
+	return hash;
+}
+
+string Linker::getCacheFileName()
+{
+	return outputFileName + ".cache";
+}
+
+void Linker::clearLinkState()
+{
+	deleteObjectFileDataList();
+	objFileDataList = nullptr;
+	objFileDataListTail = nullptr;
+	deleteSectionHeaderList();
+	shdr = nullptr;
+	shdrTail = nullptr;
+	symtab.clear();
+	symtabIndex.clear();
+	changedSymbols.clear();
+}
+
+bool Linker::loadLinkCache()
+{
+	ifstream file(getCacheFileName(), ios::binary);
+	if (!file.is_open()) return false;
+
+	CacheReader reader;
+	reader.data.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+
+	LinkCacheHeader header;
+	header.magic = reader.word();
+	header.version = reader.word();
+	header.binaryOutput = reader.word();
+	header.placeCount = reader.word();
+	header.objectCount = reader.word();
+	header.sectionCount = reader.word();
+	header.symbolCount = reader.word();
+	if (reader.failed || (header.magic != LDC_MAGIC) || (header.version != LDC_VERSION)) return false;
+
+	// The cache only holds for the same files, placement and output format
+	if ((header.binaryOutput != (binaryOutput ? 1 : 0)) || (header.placeCount != placeSectionMap.size()) ||
+		(header.objectCount != objectFileNames.size()))
+	{
+		return false;
+	}
+	for (map<string, string>::iterator it = placeSectionMap.begin(); it != placeSectionMap.end(); it++)
+	{
+		string address = reader.str();
+		string section = reader.str();
+		if ((address != it->first) || (section != it->second)) return false;
+	}
+
+	for (uint32_t i = 0; (i < header.objectCount) && !reader.failed; i++)
+	{
+		ObjectFileDataList* newElem = new ObjectFileDataList();
+		if (objFileDataList == nullptr) objFileDataList = newElem;
+		else objFileDataListTail->next = newElem;
+		objFileDataListTail = newElem;
+
+		newElem->name = reader.str();
+		newElem->hash = reader.hash();
+		newElem->symbolSignature = reader.hash();
+		newElem->symtabBegin = reader.word();
+		newElem->symtabCount = reader.word();
+		newElem->changed = false;
+		if (newElem->name != objectFileNames[i]) return false;
+
+		uint32_t sectionCount = reader.word();
+		for (uint32_t j = 0; (j < sectionCount) && !reader.failed; j++)
+		{
+			Atom name = StringInterner::intern(reader.str());
+			newElem->data.sections.push_back(name);
+			newElem->data.sectionTable[name] = reader.word();
+			newElem->partOffset[name] = reader.word();
+
+			vector<RelocationTableEntry>& relocationTable = newElem->data.sectionRelocationTable[name];
+			uint32_t relocationCount = reader.word();
+			for (uint32_t k = 0; (k < relocationCount) && !reader.failed; k++)
+			{
+				RelocationTableEntry reldata;
+				reldata.offset = reader.word();
+				reldata.type = (reader.word() == OBJ_REL_SEO_32) ? R_SEO_32 : R_ABS_32;
+				reldata.symbol = StringInterner::intern(reader.str());
+				reldata.addend = reader.word();
+				relocationTable.push_back(reldata);
+			}
+			sortRelocationTable(relocationTable);
+		}
+	}
+
+	for (uint32_t i = 0; (i < header.sectionCount) && !reader.failed; i++)
+	{
+		Atom name = StringInterner::intern(reader.str());
+		unsigned int address = reader.word();
+		unsigned int size = reader.word();
+		addNewSectionHeaderEntry(address, size, name);
+
+		uint32_t partCount = reader.word();
+		for (uint32_t j = 0; (j < partCount) && !reader.failed; j++)
+		{
+			shdrTail->entry.parts.push_back(reader.word());
+		}
+		const uint8_t* bytes = reader.bytes(size);
+		if (bytes != nullptr) shdrTail->entry.bytes.assign(bytes, bytes + size);
+	}
+
+	for (uint32_t i = 0; (i < header.symbolCount) && !reader.failed; i++)
+	{
+		int id = reader.word();
+		Atom name = StringInterner::intern(reader.str());
+		unsigned int value = reader.word();
+		ObjectSymbolType type = (reader.word() == OBJ_SYM_SECTION) ? STT_SECTION : STT_NOTYPE;
+		int sectionId = reader.word();
+		uint32_t binding = reader.word();
+		if (binding > OBJ_BIND_UNDEFINED) binding = OBJ_BIND_UNDEFINED;
+		addNewSymbolTableEntry(id, name, value, type, sectionId, (ObjectSymbolBinding)binding);
+	}
+
+	return !reader.failed && (reader.position == reader.data.size());
+}
+
+bool Linker::relinkObjectFile(ObjectFileDataList* objFile, unordered_map<Atom, SectionHeaderEntry*>& sections)
+{
+	ObjectFileData cached = objFile->data;
+	objFile->data = ObjectFileData();
+	readObjectFile(objFile);
+	ObjectFileData& data = objFile->data;
+
+	// Same sections with the same sizes keep the layout, the same symbols keep
+	// the merged table and everything the full link checked
+	if (data.sections != cached.sections) return false;
+	for (size_t i = 0; i < data.sections.size(); i++)
+	{
+		if (data.sectionTable[data.sections[i]] != cached.sectionTable[data.sections[i]]) return false;
+	}
+	if (getSymbolSignature(data) != objFile->symbolSignature) return false;
+
+	for (size_t i = 0; i < data.sections.size(); i++)
+	{
+		Atom name = data.sections[i];
+		unordered_map<Atom, SectionHeaderEntry*>::iterator section = sections.find(name);
+		if (section == sections.end()) return false;
+		SectionHeaderEntry* entry = section->second;
+		unsigned int offset = objFile->partOffset[name];
+		unsigned int size = data.sectionTable[name];
+
+		vector<uint8_t>& bytes = data.sectionData[name];
+		fill(entry->bytes.begin() + offset, entry->bytes.begin() + offset + size, 0);
+		if (min((size_t)size, bytes.size()) > 0) memcpy(entry->bytes.data() + offset, bytes.data(), min((size_t)size, bytes.size()));
+		vector<uint8_t>().swap(bytes);
+
+		vector<RelocationTableEntry>& relocationTable = data.sectionRelocationTable[name];
+		for (vector<RelocationTableEntry>::iterator record = relocationTable.begin(); record != relocationTable.end(); record++)
+		{
+			record->offset += entry->address + offset;
+			if (record->type == R_SEO_32)
+			{
+				record->addend += offset;
+			}
+		}
+	}
+
+	// Symbols come in the same order as the full link added them
+	map<int, Atom> sectionIdMap;
+	map<int, SymbolTableEntry> sortTable;
+	for (unordered_map<Atom, SymbolTableEntry>::iterator entry = data.symbolTable.begin(); entry != data.symbolTable.end(); entry++)
+	{
+		if (entry->second.type == STT_SECTION)
+		{
+			sectionIdMap[entry->second.id] = entry->second.name;
+		}
+		sortTable[entry->second.id] = entry->second;
+	}
+	unsigned int position = objFile->symtabBegin;
+	for (map<int, SymbolTableEntry>::iterator entry = sortTable.begin(); entry != sortTable.end(); entry++)
+	{
+		if ((entry->second.type != STT_NOTYPE) || (entry->second.id == 0) || (entry->second.binding == STB_EXTERN)) continue;
+		if (position >= objFile->symtabBegin + objFile->symtabCount) return false;
+
+		unsigned int value = entry->second.value;
+		map<int, Atom>::iterator sectionName = sectionIdMap.find(entry->second.sectionId);
+		if ((sectionName != sectionIdMap.end()) && sections.count(sectionName->second))
+		{
+			value += sections[sectionName->second]->address + objFile->partOffset[sectionName->second];
+		}
+
+		SymbolTableEntry& merged = symtab[position++];
+		if (merged.value != value)
+		{
+			merged.value = value;
+			changedSymbols.insert(merged.name);
+		}
+	}
+
+	return position == objFile->symtabBegin + objFile->symtabCount;
+}
+
+bool Linker::relinkFromCache()
+{
+	if (!loadLinkCache())
+	{
+		clearLinkState();
+		return false;
+	}
+
+	unordered_map<Atom, SectionHeaderEntry*> sections;
+	for (SectionHeaderList* cur = shdr; cur != nullptr; cur = cur->next)
+	{
+		sections[cur->entry.name] = &cur->entry;
+	}
+
+	for (ObjectFileDataList* objFile = objFileDataList; objFile != nullptr; objFile = objFile->next)
+	{
+		uint64_t hash = hashObjectFile(objFile->name);
+		if (hash == objFile->hash) continue;
+
+		objFile->hash = hash;
+		objFile->changed = true;
+		if (!relinkObjectFile(objFile, sections))
+		{
+			clearLinkState();
+			return false;
+		}
+	}
+
+	collectSectionRelocations();
+	rewriteRelocationData();
+	return true;
+}
+
+void Linker::saveLinkCache()
+{
+	ofstream output(getCacheFileName(), ios::binary);
+	if (!output.is_open())
+	{
+		errorMessage("Error: Error in opening file '" + getCacheFileName() + "'!");
+	}
+
+	uint32_t objectCount = 0;
+	uint32_t sectionCount = 0;
+	for (ObjectFileDataList* objFile = objFileDataList; objFile != nullptr; objFile = objFile->next) objectCount++;
+	for (SectionHeaderList* cur = shdr; cur != nullptr; cur = cur->next) sectionCount++;
+
+	LinkCacheHeader header;
+	header.magic = LDC_MAGIC;
+	header.version = LDC_VERSION;
+	header.binaryOutput = binaryOutput ? 1 : 0;
+	header.placeCount = placeSectionMap.size();
+	header.objectCount = objectCount;
+	header.sectionCount = sectionCount;
+	header.symbolCount = symtab.size();
+	output.write((const char*)&header, sizeof(header));
+
+	for (map<string, string>::iterator it = placeSectionMap.begin(); it != placeSectionMap.end(); it++)
+	{
+		writeCacheString(output, it->first);
+		writeCacheString(output, it->second);
+	}
+
+	for (ObjectFileDataList* objFile = objFileDataList; objFile != nullptr; objFile = objFile->next)
+	{
+		writeCacheString(output, objFile->name);
+		writeCacheHash(output, objFile->hash);
+		writeCacheHash(output, objFile->symbolSignature);
+		writeCacheWord(output, objFile->symtabBegin);
+		writeCacheWord(output, objFile->symtabCount);
+		writeCacheWord(output, objFile->data.sections.size());
+		for (size_t i = 0; i < objFile->data.sections.size(); i++)
+		{
+			Atom name = objFile->data.sections[i];
+			writeCacheString(output, StringInterner::name(name));
+			writeCacheWord(output, objFile->data.sectionTable[name]);
+			writeCacheWord(output, objFile->partOffset[name]);
+
+			vector<RelocationTableEntry>& relocationTable = objFile->data.sectionRelocationTable[name];
+			writeCacheWord(output, relocationTable.size());
+			for (vector<RelocationTableEntry>::iterator record = relocationTable.begin(); record != relocationTable.end(); record++)
+			{
+				writeCacheWord(output, record->offset);
+				writeCacheWord(output, record->type);
+				writeCacheString(output, StringInterner::name(record->symbol));
+				writeCacheWord(output, record->addend);
+			}
+		}
+	}
+
+	for (SectionHeaderList* cur = shdr; cur != nullptr; cur = cur->next)
+	{
+		writeCacheString(output, StringInterner::name(cur->entry.name));
+		writeCacheWord(output, cur->entry.address);
+		writeCacheWord(output, cur->entry.size);
+		writeCacheWord(output, cur->entry.parts.size());
+		for (size_t i = 0; i < cur->entry.parts.size(); i++)
+		{
+			writeCacheWord(output, cur->entry.parts[i]);
+		}
+		writeCacheBytes(output, cur->entry.bytes.data(), cur->entry.bytes.size());
+	}
+
+	for (size_t i = 0; i < symtab.size(); i++)
+	{
+		writeCacheWord(output, symtab[i].id);
+		writeCacheString(output, StringInterner::name(symtab[i].name));
+		writeCacheWord(output, symtab[i].value);
+		writeCacheWord(output, symtab[i].type);
+		writeCacheWord(output, symtab[i].sectionId);
+		writeCacheWord(output, symtab[i].binding);
+	}
+}
+
 void Linker::generateHexFile()
 {
-	readObjectFiles();					// DONE 
-	checkSymbolsForError();				// DONE
-	checkSectionsForOverlapping();		// DONE
-	updateSymbolTable();				// DONE
-	updateCodeAddresses();				// DONE
-	updateRelocationTable();			// DONE
+	if (!incremental || !relinkFromCache())
+	{
+		readObjectFiles();					// DONE 
+		checkSymbolsForError();				// DONE
+		checkSectionsForOverlapping();		// DONE
+		updateSymbolTable();				// DONE
+		updateCodeAddresses();				// DONE
+		updateRelocationTable();			// DONE
+		collectSectionRelocations();
+		rewriteRelocationData();			// DONE
+	}
 
-	printHexCode(linkerInfo);
-	rewriteRelocationData();			// DONE
-	printHexCode(linkerInfo);
+	// Relocated words are listed as ???????? in the first listing
+	printHexCode(linkerInfo, false);
+	printHexCode(linkerInfo, true);
 
 	printSectionHeader(linkerInfo);
 	printSymbolTable(linkerInfo);
 	printRelocationTable(linkerInfo);
 
 	createOutputFile();
+	if (incremental) saveLinkCache();
 }
 
 
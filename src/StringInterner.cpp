@@ -0,0 +1,49 @@
+#include "StringInterner.h"
+
+StringInterner::Pool::Pool()
+{
+	shards[0].names.push_back("");
+	shards[0].atoms.emplace("", 0);
+}
+
+// Never destroyed, threads still interning must not see it torn down
+// when another one calls exit on an error
+StringInterner::Pool& StringInterner::pool()
+{
+	static Pool& instance = *new Pool;
+	return instance;
+}
+
+unsigned int StringInterner::shardOf(const string& name)
+{
+	if (name.empty()) return 0;
+	return hash<string>()(name) & (INTERNER_SHARDS - 1);
+}
+
+Atom StringInterner::intern(const string& name)
+{
+	unsigned int index = shardOf(name);
+	Shard& shard = pool().shards[index];
+	lock_guard<mutex> guard(shard.lock);
+	unordered_map<string, Atom>::iterator it = shard.atoms.find(name);
+	if (it != shard.atoms.end()) return it->second;
+	Atom atom = (shard.names.size() << INTERNER_SHARD_BITS) | index;
+	shard.names.push_back(name);
+	shard.atoms.emplace(name, atom);
+	return atom;
+}
+
+Atom StringInterner::find(const string& name)
+{
+	Shard& shard = pool().shards[shardOf(name)];
+	lock_guard<mutex> guard(shard.lock);
+	unordered_map<string, Atom>::iterator it = shard.atoms.find(name);
+	return (it != shard.atoms.end()) ? it->second : NO_ATOM;
+}
+
+const string& StringInterner::name(Atom atom)
+{
+	Shard& shard = pool().shards[atom & (INTERNER_SHARDS - 1)];
+	lock_guard<mutex> guard(shard.lock);
+	return shard.names[atom >> INTERNER_SHARD_BITS];
+}
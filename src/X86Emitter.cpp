@@ -0,0 +1,243 @@
+#include "X86Emitter.h"
+
+void X86Emitter::emitByte(uint8_t value)
+{
+	code.push_back(value);
+}
+
+void X86Emitter::emitWord(uint32_t value)
+{
+	for (int i = 0; i < 4; i++) code.push_back((value >> (8 * i)) & 0xFF);
+}
+
+void X86Emitter::emitRex(bool wide, int reg, int base)
+{
+	uint8_t rex = 0x40 | (wide ? 0x08 : 0) | (((reg >> 3) & 1) << 2) | ((base >> 3) & 1);
+	if (rex != 0x40) emitByte(rex);
+}
+
+void X86Emitter::emitMemoryOperand(int reg, HostRegister base, int32_t disp)
+{
+	// mod 10: [base + disp32]
+	emitByte(0x80 | ((reg & 7) << 3) | (base & 7));
+	emitWord(disp);
+}
+
+void X86Emitter::movRegReg(HostRegister dst, HostRegister src)
+{
+	emitRex(false, src, dst);
+	emitByte(0x89);
+	emitByte(0xC0 | ((src & 7) << 3) | (dst & 7));
+}
+
+void X86Emitter::movRegImm(HostRegister dst, uint32_t imm)
+{
+	emitRex(false, 0, dst);
+	emitByte(0xB8 + (dst & 7));
+	emitWord(imm);
+}
+
+void X86Emitter::movRegImm64(HostRegister dst, uint64_t imm)
+{
+	emitRex(true, 0, dst);
+	emitByte(0xB8 + (dst & 7));
+	emitWord(imm & 0xFFFFFFFF);
+	emitWord(imm >> 32);
+}
+
+void X86Emitter::load(HostRegister dst, HostRegister base, int32_t disp)
+{
+	emitRex(false, dst, base);
+	emitByte(0x8B);
+	emitMemoryOperand(dst, base, disp);
+}
+
+void X86Emitter::store(HostRegister base, int32_t disp, HostRegister src)
+{
+	emitRex(false, src, base);
+	emitByte(0x89);
+	emitMemoryOperand(src, base, disp);
+}
+
+void X86Emitter::storeImm(HostRegister base, int32_t disp, uint32_t imm)
+{
+	emitRex(false, 0, base);
+	emitByte(0xC7);
+	emitMemoryOperand(0, base, disp);
+	emitWord(imm);
+}
+
+void X86Emitter::load64(HostRegister dst, HostRegister base, int32_t disp)
+{
+	emitRex(true, dst, base);
+	emitByte(0x8B);
+	emitMemoryOperand(dst, base, disp);
+}
+
+void X86Emitter::store64(HostRegister base, int32_t disp, HostRegister src)
+{
+	emitRex(true, src, base);
+	emitByte(0x89);
+	emitMemoryOperand(src, base, disp);
+}
+
+void X86Emitter::loadStackSlot(HostRegister dst)
+{
+	// [rsp] needs a SIB byte
+	emitRex(false, dst, 0);
+	emitByte(0x8B);
+	emitByte(0x04 | ((dst & 7) << 3));
+	emitByte(0x24);
+}
+
+void X86Emitter::storeStackSlot(HostRegister src)
+{
+	emitRex(false, src, 0);
+	emitByte(0x89);
+	emitByte(0x04 | ((src & 7) << 3));
+	emitByte(0x24);
+}
+
+void X86Emitter::alu(AluOperation op, HostRegister dst, HostRegister src)
+{
+	emitRex(false, src, dst);
+	emitByte(op);
+	emitByte(0xC0 | ((src & 7) << 3) | (dst & 7));
+}
+
+void X86Emitter::addImm(HostRegister dst, uint32_t imm)
+{
+	emitRex(false, 0, dst);
+	emitByte(0x81);
+	emitByte(0xC0 | (dst & 7));
+	emitWord(imm);
+}
+
+void X86Emitter::addImm64(HostRegister dst, uint32_t imm)
+{
+	// imm is sign-extended to 64 bits
+	emitRex(true, 0, dst);
+	emitByte(0x81);
+	emitByte(0xC0 | (dst & 7));
+	emitWord(imm);
+}
+
+void X86Emitter::cmp64(HostRegister left, HostRegister base, int32_t disp)
+{
+	emitRex(true, left, base);
+	emitByte(0x3B);
+	emitMemoryOperand(left, base, disp);
+}
+
+void X86Emitter::imul(HostRegister dst, HostRegister src)
+{
+	emitRex(false, dst, src);
+	emitByte(0x0F);
+	emitByte(0xAF);
+	emitByte(0xC0 | ((dst & 7) << 3) | (src & 7));
+}
+
+void X86Emitter::div(HostRegister src)
+{
+	// edx:eax / src, quotient in eax
+	emitRex(false, 0, src);
+	emitByte(0xF7);
+	emitByte(0xC0 | (6 << 3) | (src & 7));
+}
+
+void X86Emitter::notReg(HostRegister dst)
+{
+	emitRex(false, 0, dst);
+	emitByte(0xF7);
+	emitByte(0xC0 | (2 << 3) | (dst & 7));
+}
+
+void X86Emitter::shlCl(HostRegister dst)
+{
+	emitRex(false, 0, dst);
+	emitByte(0xD3);
+	emitByte(0xC0 | (4 << 3) | (dst & 7));
+}
+
+void X86Emitter::shrCl(HostRegister dst)
+{
+	emitRex(false, 0, dst);
+	emitByte(0xD3);
+	emitByte(0xC0 | (5 << 3) | (dst & 7));
+}
+
+void X86Emitter::cmpByteZero(HostRegister base)
+{
+	emitRex(false, 0, base);
+	emitByte(0x80);
+	emitMemoryOperand(7, base, 0);
+	emitByte(0x00);
+}
+
+void X86Emitter::push64(HostRegister reg)
+{
+	emitRex(false, 0, reg);
+	emitByte(0x50 + (reg & 7));
+}
+
+void X86Emitter::pop64(HostRegister reg)
+{
+	emitRex(false, 0, reg);
+	emitByte(0x58 + (reg & 7));
+}
+
+void X86Emitter::subRsp(uint8_t imm)
+{
+	emitByte(0x48);
+	emitByte(0x83);
+	emitByte(0xEC);
+	emitByte(imm);
+}
+
+void X86Emitter::addRsp(uint8_t imm)
+{
+	emitByte(0x48);
+	emitByte(0x83);
+	emitByte(0xC4);
+	emitByte(imm);
+}
+
+void X86Emitter::call64(HostRegister target)
+{
+	emitRex(false, 0, target);
+	emitByte(0xFF);
+	emitByte(0xC0 | (2 << 3) | (target & 7));
+}
+
+void X86Emitter::ret()
+{
+	emitByte(0xC3);
+}
+
+size_t X86Emitter::jumpForward(JumpCondition condition)
+{
+	if (condition == JUMP_ALWAYS)
+	{
+		emitByte(0xE9);
+	}
+	else
+	{
+		emitByte(0x0F);
+		emitByte(condition);
+	}
+	size_t patch = code.size();
+	emitWord(0);
+	return patch;
+}
+
+void X86Emitter::bindJump(size_t patch)
+{
+	uint32_t rel = code.size() - (patch + 4);
+	for (int i = 0; i < 4; i++) code[patch + i] = (rel >> (8 * i)) & 0xFF;
+}
+
+void X86Emitter::jumpBack(size_t target)
+{
+	emitByte(0xE9);
+	emitWord(target - (code.size() + 4));
+}
@@ -1,6 +1,8 @@
 #include <iostream>
 #include <regex>
 #include <vector>
+#include <thread>
+#include <atomic>
 
 #include "Assembler.h"
 
@@ -12,7 +14,30 @@ void helpmsg()
             "./assembler [options] <input_file_name>\n\n" <<
             "Options:\n   " << 
             "-o <output_file_name>   Places assembler output in file <output_file_name>\n\t\t\t" <<
-            "   If option is not specified the output is placed in <input_file_name>.o\n\n"<< endl;
+            "   If option is not specified the output is placed in <input_file_name>.o\n\n   " <<
+            "-text                   Writes the object file as readable text instead of binary\n\n   " <<
+            "-j <N> <input_files>    Assembles all input files on N threads, each into <input_file_name>.o\n\n" << endl;
+}
+
+void assembleInParallel(vector<string> inputFiles, vector<string> outputFiles, int threadCount, bool textOutput)
+{
+    atomic<size_t> next(0);
+    vector<thread> workers;
+    for (int t = 0; t < threadCount; t++)
+    {
+        workers.push_back(thread([&]()
+        {
+            for (size_t i = next++; i < inputFiles.size(); i = next++)
+            {
+                Assembler as(inputFiles[i], outputFiles[i], textOutput);
+                as.generateObjectFile();
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++)
+    {
+        workers[t].join();
+    }
 }
 
 int main(int argc, char** argv)
@@ -21,6 +46,7 @@ int main(int argc, char** argv)
     {
         string inputFile;
         string outputFile;
+        bool textOutput = false;
 
         vector<string> paramlist;
 
@@ -29,10 +55,50 @@ int main(int argc, char** argv)
 
         for(int i = 1; i < argc; i++)
         {
+            if (string(argv[i]) == "-text")
+            {
+                textOutput = true;
+                continue;
+            }
             paramlist.push_back(argv[i]);
         }
 
-        if (paramlist[0] == "-o")
+        if (paramlist.size() == 0)
+        {
+            cerr << "Error: Input file missing!\n" << endl;
+            helpmsg();
+            exit(1);
+        }
+
+        if (paramlist[0] == "-j")
+        {
+            int threadCount = (paramlist.size() > 1) ? atoi(paramlist[1].c_str()) : 0;
+            if ((threadCount < 1) || (paramlist.size() < 3))
+            {
+                cerr << "Error: Option -j requires a thread count and at least one input file!\n" << endl;
+                helpmsg();
+                exit(1);
+            }
+
+            vector<string> inputFiles;
+            vector<string> outputFiles;
+            regex r("\\.s$");
+            for (size_t i = 2; i < paramlist.size(); i++)
+            {
+                if (!regex_match(paramlist[i], input))
+                {
+                    cerr << "Input must be assembly file (.s)\n" << endl;
+                    helpmsg();
+                    exit(1);
+                }
+                inputFiles.push_back(paramlist[i]);
+                outputFiles.push_back(regex_replace(paramlist[i], r, ".o"));
+            }
+
+            assembleInParallel(inputFiles, outputFiles, threadCount, textOutput);
+            return 0;
+        }
+        else if (paramlist[0] == "-o")
         {
             inputFile = paramlist[2];
             outputFile = paramlist[1];
@@ -66,7 +132,7 @@ int main(int argc, char** argv)
             exit(1);
         }
 
-        Assembler as(inputFile, outputFile);
+        Assembler as(inputFile, outputFile, textOutput);
         as.generateObjectFile();
     }
     else{
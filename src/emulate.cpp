@@ -8,24 +8,45 @@ using namespace std;
 void helpmsg()
 {
 	cout << "The emulator can be run with:\n" <<
-		"./emulator <input_hex_file>\n\n" << endl;
+		"./emulator [options] <input_hex_file>\n" <<
+		"./emulator [options] <input_image_file>\n\n" <<
+		"Options:\n   " <<
+		"--jit                   Compiles blocks that ran " << JIT_THRESHOLD << " times to native code\n\n   " <<
+		"--jit=<N>               Compiles blocks that ran N times to native code\n\n" << endl;
 }
 
 int main(int argc, char** argv)
 {
+	unsigned int jitThreshold = 0;
+	if ((argc == 3) && (string(argv[1]).compare(0, 5, "--jit") == 0))
+	{
+		string option = argv[1];
+		if (option == "--jit") jitThreshold = JIT_THRESHOLD;
+		else if ((option[5] == '=') && (atoi(option.c_str() + 6) > 0)) jitThreshold = atoi(option.c_str() + 6);
+		else
+		{
+			cerr << "Error: Unknown option '" << option << "'!\n";
+			helpmsg();
+			return 0;
+		}
+		argv++;
+		argc--;
+	}
+
 	if (argc == 2)
 	{
 		string inputHexFile = argv[1];
 		regex hexFile("^.*\\.hex$");
+		regex imageFile("^.*\\.img$");
 
-		if (!regex_match(inputHexFile, hexFile))
+		if (!regex_match(inputHexFile, hexFile) && !regex_match(inputHexFile, imageFile))
 		{
-			cerr << "Error: Input file must be hex file (.hex)!";
+			cerr << "Error: Input file must be hex file (.hex) or image file (.img)!";
 			helpmsg();
 			return 0;
 		}
 
-		Emulator processor(inputHexFile);
+		Emulator processor(inputHexFile, jitThreshold);
 		processor.executeHexProgeam();
 	}
 	else
@@ -2,6 +2,7 @@
 #include <vector>
 #include <regex>
 #include <map>
+#include <thread>
 
 #include "Linker.h"
 
@@ -16,6 +17,10 @@ void helpmsg()
 		"             If option is not specified the output is placed in out.hex\n\n   " <<
 		"-hex                              Indicates that the linker output is a hex file\n\t\t\t" <<
 		"             If option is not specified the linker does not output anything\n\n   " <<
+		"-bin                              Indicates that the linker output is a binary memory image (.img)\n\n   " <<
+		"-j <N>                            Reads input files on N threads, by default one per hardware thread\n\n   " <<
+		"--incremental                     Keeps the link in <output_file_name>.cache and next time only\n\t\t\t" <<
+		"             patches objects that changed since then\n\n   " <<
 		"-place=<section_name>@<address>   Places section in the specified address location\n\t\t\t" << endl;
 }
 
@@ -26,6 +31,7 @@ int main(int argc, char** argv)
 		string outputFile;
 		vector<string> inputFileList;
 		map<string, string> placeSection;
+		unsigned int threadCount = thread::hardware_concurrency();
 
 		vector<string> params;
 		for (int i = 1; i < argc; i++)
@@ -38,12 +44,15 @@ int main(int argc, char** argv)
 		regex option_place("^-place=(" + sectionName + ")@(" + hexAddress + ")$");
 		regex objFileName("^.*\\.o$");
 		regex hexFileName("^.*\\.hex$");
+		regex imageFileName("^.*\\.img$");
 		regex place("^-place=");
 		regex notSectionName("@.*$");
 		regex notAddressValue("^.*@");
 
 		bool hexFound = false;
+		bool binFound = false;
 		bool nameFound = false;
+		bool incremental = false;
 		for (int i = 0; i < params.size(); i++)
 		{
 			if (params[i] == "-hex")
@@ -51,19 +60,44 @@ int main(int argc, char** argv)
 				hexFound = true;
 				continue;
 			}
+			if (params[i] == "-bin")
+			{
+				binFound = true;
+				continue;
+			}
+			if (params[i] == "--incremental")
+			{
+				incremental = true;
+				continue;
+			}
+			if (params[i] == "-j")
+			{
+				i++;
+				if ((i < params.size()) && (atoi(params[i].c_str()) > 0))
+				{
+					threadCount = atoi(params[i].c_str());
+				}
+				else
+				{
+					cerr << "Error: Option -j requires a thread count!\n" << endl;
+					helpmsg();
+					return 0;
+				}
+				continue;
+			}
 			if (params[i] == "-o")
 			{
 				i++;
 				if (i < params.size())
 				{
-					if (regex_match(params[i], hexFileName))
+					if (regex_match(params[i], hexFileName) || regex_match(params[i], imageFileName))
 					{
 						outputFile = params[i];
 						nameFound = true;
 					}
 					else
 					{
-						cerr << "Error: Output must be hex file (.hex)!\n" << endl;
+						cerr << "Error: Output must be hex file (.hex) or image file (.img)!\n" << endl;
 						helpmsg();
 						return 0;
 					}
@@ -94,9 +128,9 @@ int main(int argc, char** argv)
 			return 0;
 		}
 
-		if (!hexFound) return 0;
+		if (!hexFound && !binFound) return 0;
 
-		if (!nameFound) outputFile = "out.hex";
+		if (!nameFound) outputFile = binFound ? "out.img" : "out.hex";
 
 		if (inputFileList.size() == 0)
 		{
@@ -105,7 +139,7 @@ int main(int argc, char** argv)
 			return 0;
 		}
 
-		Linker ld(outputFile, inputFileList, placeSection);
+		Linker ld(outputFile, inputFileList, placeSection, binFound, threadCount, incremental);
 		ld.generateHexFile();
 	}
 	else
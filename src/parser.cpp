@@ -1,454 +1,409 @@
 #include "parser.h"
+#include <unordered_map>
 
 /*
 ######################################################################
 
-    REGEX STRINGS
+    CHARACTER CLASSES
 
 ######################################################################
 */
-string sectionName = "[a-zA-Z_][a-zA-Z0-9_]*";
-string symbol = "[a-zA-Z_][a-zA-Z0-9_]*";
-string symbolList = "("+symbol+")(, ("+symbol+"))*";
-string numberLiteral = "-?(0|[1-9]\\d*)";
-string hexLiteral = "0x[0-9A-F]+";
-string symbolOrLiteral = "("+symbol+")|("+hexLiteral+")|("+numberLiteral+")";
-string symbolOrLiteralList = "("+symbolOrLiteral+")(, ("+symbolOrLiteral+"))*";
-string gpr = "%(r([0-9]|1[0-5])|sp|pc)";
-string csr = "%(status|handler|cause)";
-string gprOrCsr = "("+gpr+")|("+csr+")";
-string immed = "\\$("+symbolOrLiteral+")";
-string memdir = symbolOrLiteral;
-string regdir = gprOrCsr;
-string regind = "\\[("+gprOrCsr+")\\]";
-string reginddisp = "\\[("+gprOrCsr+") \\+ ("+symbolOrLiteral+")\\]";
-
-string labelName = "[a-zA-Z_][a-zA-Z0-9_]*";
-
-/*
-######################################################################
-
-    REGEX HELPERS
-
-######################################################################
-*/
-regex addSpaceAfterComma(",");
-regex removeSpaceBeforeComma("[\\s]*,");
-regex addNewLineAfterColon(":[\\s]*");
-regex whitespaceFront("^[\\s]+");
-regex whitespaceBack("[\\s]+$");
-regex whitespace("[\\s]+");
-regex comments("#.*");
-regex badSkipLiteral("^\\.skip ((-)?(0(x(0)+)?)|(-[1-9]\\d*))$");
-
-regex globalDir("^\\.global ("+symbolList+")$");
-regex externDir("^\\.extern ("+symbolList+")$");
-regex sectionDir("^\\.section ("+sectionName+")$");
-regex wordDir("^\\.word ("+symbolOrLiteralList+")$");
-regex skipDir("^\\.skip (("+hexLiteral+")|("+numberLiteral+"))$");
-regex endDir("^\\.end$");
-
-regex halt("^halt$");
-regex interrupt("^int$");
-regex iret("^iret$");
-regex call("^call ("+symbolOrLiteral+")$");
-regex ret("^ret$");
-regex jmp("^jmp ("+symbolOrLiteral+")$");
-regex beq("^beq ("+gpr+"), ("+gpr+"), ("+symbolOrLiteral+")$");
-regex bne("^bne ("+gpr+"), ("+gpr+"), ("+symbolOrLiteral+")$");
-regex bgt("^bgt ("+gpr+"), ("+gpr+"), ("+symbolOrLiteral+")$");
-regex push("^push ("+gpr+")$");
-regex pop("^pop ("+gpr+")$");
-regex xchg("^xchg ("+gpr+"), ("+gpr+")$");
-regex add("^add ("+gpr+"), ("+gpr+")$");
-regex sub("^sub ("+gpr+"), ("+gpr+")$");
-regex mul("^mul ("+gpr+"), ("+gpr+")$");
-regex div_("^div ("+gpr+"), ("+gpr+")$");
-regex neg("^not ("+gpr+")$");
-regex and_("^and ("+gpr+"), ("+gpr+")$");
-regex or_("^or ("+gpr+"), ("+gpr+")$");
-regex xor_("^xor ("+gpr+"), ("+gpr+")$");
-regex shl("^shl ("+gpr+"), ("+gpr+")$");
-regex shr("^shr ("+gpr+"), ("+gpr+")$");
-regex csrrd("^csrrd ("+csr+"), ("+gpr+")$");
-regex csrwr("^csrwr ("+gpr+"), ("+csr+")$");
-regex loadImmed("^ld ("+immed+"), ("+gpr+")$");
-regex loadMemDir("^ld ("+memdir+"), ("+gpr+")$");
-regex loadRegDir("^ld ("+regdir+"), ("+gpr+")$");
-regex loadRegInd("^ld ("+regind+"), ("+gpr+")$");
-regex loadRegIndDisp("^ld ("+reginddisp+"), ("+gpr+")$");
-regex storeImmed("^st ("+gpr+"), ("+immed+")$");
-regex storeMemDir("^st ("+gpr+"), ("+memdir+")$");
-regex storeRegDir("^st ("+gpr+"), ("+regdir+")$");
-regex storeRegInd("^st ("+gpr+"), ("+regind+")$");
-regex storeRegIndDisp("^st ("+gpr+"), ("+reginddisp+")$");
-
-regex label("^("+labelName+"):$");
-regex symbol_("^("+symbol+")$");
-regex hex_("^("+hexLiteral+")$");
-regex number_("^("+numberLiteral+")$");
-
-regex column(":");
-regex percent("%");
-regex lbrack("\\[");
-regex rbrack("\\]");
-regex notFirstReg(",.*$");
-regex notSecondReg("^.*, ");
-regex notBranchFirstReg(",.*$");
-regex notBranchSecondRegFront("^.*, %");
-regex notBranchSecondRegBack(",.*$");
-regex notBranchOperand("^.*, ");
-regex notLoadOperand(",.*$");
-regex notLoadRegister("^.*%");
-regex notStoreRegister(",.*$");
-regex notStoreOperand("^.*, ");
-regex notIndDispRegister(" .*$");
-regex notIndDispSymOrLit("^.*\\+ ");
-
-/*
-######################################################################
-
-    LINE FORMATING REGEX
-
-######################################################################
-*/
-void formatLine(string& line)
-{
-	// Remove line comments
-	line = regex_replace(line, comments, "");
-	// Remove whitespace in front
-	line = regex_replace(line, whitespaceFront, "");
-	// Add whitespace after comma
-	line = regex_replace(line, addSpaceAfterComma, ", ");
-	// Remove whitespace before comma
-	line = regex_replace(line, removeSpaceBeforeComma, ",");
-	// Remove excess whitespaces
-	line = regex_replace(line, whitespace, " ");
-	// Add newline after colon
-	line = regex_replace(line, addNewLineAfterColon, ":\n");
-	// Remove whitespace in back
-	line = regex_replace(line, whitespaceBack, "");
-	// Remove skip directives with bad literal
-	line = regex_replace(line, badSkipLiteral, "");
-}
-
-void removeTrailingZeros(string& line)
-{
-    int cnt = 0;
-    for(int i = 0; i < line.length(); i++)
-    {
-        if (line[i] != '0') break;
-        cnt++;
-    }
-    line = line.substr(cnt);
-}
-
-/*
-######################################################################
-
-    ASSEMBLY DIRECTIVES
-
-######################################################################
-*/
-bool isDirectiveGlobal(string line)
+static bool isWhitespace(char c)
 {
-    return regex_match(line, globalDir);
+    return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\v') || (c == '\f') || (c == '\r');
 }
 
-bool isDirectiveExtern(string line)
+static bool isDigit(char c)
 {
-    return regex_match(line, externDir);
+    return ('0' <= c) && (c <= '9');
 }
 
-bool isDirectiveSection(string line)
+static bool isHexDigit(char c)
 {
-    return regex_match(line, sectionDir);
+    return isDigit(c) || (('A' <= c) && (c <= 'F'));
 }
 
-bool isDirectiveWord(string line)
+static bool isSymbolStart(char c)
 {
-    return regex_match(line, wordDir);
+    return (('a' <= c) && (c <= 'z')) || (('A' <= c) && (c <= 'Z')) || (c == '_');
 }
 
-bool isDirectiveSkip(string line)
+static bool isSymbolChar(char c)
 {
-    return regex_match(line, skipDir);
+    return isSymbolStart(c) || isDigit(c);
 }
 
-bool isDirectiveEnd(string line)
-{
-    return regex_match(line, endDir);
-}
 /*
 ######################################################################
 
-    ASSEMBLY INSTRUCTIONS
+    OPERAND SCANNERS
+
+    Every scanner starts at position i of a formatted line. On success
+    it moves i past the recognized token and returns true.
 
 ######################################################################
 */
-
-bool isInstructionHalt(string line)
-{
-    return regex_match(line, halt);
-}
-
-bool isInstructionInt(string line)
-{
-    return regex_match(line, interrupt);
-}
-
-bool isInstructionIret(string line)
-{
-    return regex_match(line, iret);
-}
-
-bool isInstructionCall(string line)
-{
-    return regex_match(line, call);
-}
-
-bool isInstructionRet(string line)
-{
-    return regex_match(line, ret);
-}
-
-bool isInstructionJmp(string line)
-{
-    return regex_match(line, jmp);
-}
-
-bool isInstructionBeq(string line)
-{
-    return regex_match(line, beq);
-}
-
-bool isInstructionBne(string line)
-{
-    return regex_match(line, bne);
-}
-
-bool isInstructionBgt(string line)
-{
-    return regex_match(line, bgt);
-}
-
-bool isInstructionPush(string line)
-{
-    return regex_match(line, push);
-}
-
-bool isInstructionPop(string line)
-{
-    return regex_match(line, pop);
-}
-
-bool isInstructionExchange(string line)
-{
-    return regex_match(line, xchg);
-}
-
-bool isInstructionAdd(string line)
-{
-    return regex_match(line, add);
-}
-
-bool isInstructionSub(string line)
-{
-    return regex_match(line, sub);
-}
-
-bool isInstructionMul(string line)
-{
-    return regex_match(line, mul);
-}
-
-bool isInstructionDiv(string line)
-{
-    
-    return regex_match(line, div_);
-}
-
-bool isInstructionNot(string line)
-{
-    return regex_match(line, neg);
-}
-
-bool isInstructionAnd(string line)
-{
-    return regex_match(line, and_);
-}
-
-bool isInstructionOr(string line)
-{
-    return regex_match(line, or_);
-}
-
-bool isInstructionXor(string line)
-{
-    return regex_match(line, xor_);
-}
-
-bool isInstructionShl(string line)
-{
-    return regex_match(line, shl);
-}
-
-bool isInstructionShr(string line)
+static bool scanSymbol(const string& line, size_t& i)
 {
-    return regex_match(line, shr);
+    if ((i >= line.length()) || !isSymbolStart(line[i])) return false;
+    i++;
+    while ((i < line.length()) && isSymbolChar(line[i])) i++;
+    return true;
 }
 
-bool isInstructionCsrrd(string line)
+static bool scanHexLiteral(const string& line, size_t& i)
 {
-    return regex_match(line, csrrd);
+    if ((i + 2 >= line.length()) || (line[i] != '0') || (line[i + 1] != 'x') || !isHexDigit(line[i + 2])) return false;
+    i += 3;
+    while ((i < line.length()) && isHexDigit(line[i])) i++;
+    return true;
 }
 
-bool isInstructionCsrwr(string line)
+static bool scanNumberLiteral(const string& line, size_t& i)
 {
-    return regex_match(line, csrwr);
-}
-
-bool isInstructionLoadImmed(string line)
-{
-    return regex_match(line, loadImmed);
+    size_t j = i;
+    if ((j < line.length()) && (line[j] == '-')) j++;
+    if ((j >= line.length()) || !isDigit(line[j])) return false;
+    if (line[j++] != '0')
+    {
+        while ((j < line.length()) && isDigit(line[j])) j++;
+    }
+    i = j;
+    return true;
 }
 
-bool isInstructionLoadMemDir(string line)
+static bool scanSymbolOrLiteral(const string& line, size_t& i, string& operand, OperandKind& kind)
 {
-    return regex_match(line, loadMemDir);
+    size_t begin = i;
+    if (scanSymbol(line, i)) kind = OPERAND_SYMBOL;
+    else if (scanHexLiteral(line, i)) kind = OPERAND_HEX;
+    else if (scanNumberLiteral(line, i)) kind = OPERAND_NUMBER;
+    else return false;
+    operand = line.substr(begin, i - begin);
+    return true;
 }
 
-bool isInstructionLoadRegDir(string line)
+static bool scanRegister(const string& line, size_t& i, string& reg, bool allowGPR, bool allowCSR)
 {
-    return regex_match(line, loadRegDir);
-}
+    if ((i >= line.length()) || (line[i] != '%')) return false;
+    size_t begin = ++i;
+    while ((i < line.length()) && isSymbolChar(line[i])) i++;
+    reg = line.substr(begin, i - begin);
 
-bool isInstructionLoadRegInd(string line)
-{
-    return regex_match(line, loadRegInd);
+    if (allowCSR && ((reg == "status") || (reg == "handler") || (reg == "cause"))) return true;
+    if (!allowGPR) return false;
+    if ((reg == "sp") || (reg == "pc")) return true;
+    if ((reg.length() == 2) && (reg[0] == 'r') && isDigit(reg[1])) return true;
+    if ((reg.length() == 3) && (reg[0] == 'r') && (reg[1] == '1') && ('0' <= reg[2]) && (reg[2] <= '5')) return true;
+    return false;
 }
 
-bool isInstructionLoadRegIndDisp(string line)
+static bool scanText(const string& line, size_t& i, const char* text)
 {
-    return regex_match(line, loadRegIndDisp);
+    size_t j = i;
+    while (*text != '\0')
+    {
+        if ((j >= line.length()) || (line[j] != *text)) return false;
+        j++;
+        text++;
+    }
+    i = j;
+    return true;
 }
 
-bool isInstructionStoreImmed(string line)
+static bool scanList(const string& line, size_t& i, ParsedLine& parsed, bool allowLiterals)
 {
-    return regex_match(line, storeImmed);
+    while (true)
+    {
+        size_t begin = i;
+        string param;
+        OperandKind kind = OPERAND_SYMBOL;
+        if (allowLiterals)
+        {
+            if (!scanSymbolOrLiteral(line, i, param, kind)) return false;
+        }
+        else
+        {
+            if (!scanSymbol(line, i)) return false;
+            param = line.substr(begin, i - begin);
+        }
+        parsed.params.push_back(param);
+        parsed.paramKinds.push_back(kind);
+        if (!scanText(line, i, ", ")) return true;
+    }
 }
 
-bool isInstructionStoreMemDir(string line)
+/*
+    Memory operand of ld/st: $immed, memdir, %reg, [%reg] or [%reg + disp].
+    Returns offset of the addressing mode from the IMMED line type.
+*/
+static bool scanMemoryOperand(const string& line, size_t& i, ParsedLine& parsed, string& reg, int& mode)
 {
-    return regex_match(line, storeMemDir);
+    if (scanText(line, i, "$"))
+    {
+        mode = 0;
+        return scanSymbolOrLiteral(line, i, parsed.operand, parsed.operandKind);
+    }
+    if ((i < line.length()) && (line[i] == '%'))
+    {
+        mode = 2;
+        return scanRegister(line, i, reg, true, true);
+    }
+    if (scanText(line, i, "["))
+    {
+        if (!scanRegister(line, i, reg, true, true)) return false;
+        if (scanText(line, i, "]"))
+        {
+            mode = 3;
+            return true;
+        }
+        mode = 4;
+        return scanText(line, i, " + ") && scanSymbolOrLiteral(line, i, parsed.operand, parsed.operandKind) && scanText(line, i, "]");
+    }
+    mode = 1;
+    return scanSymbolOrLiteral(line, i, parsed.operand, parsed.operandKind);
 }
 
-bool isInstructionStoreRegDir(string line)
-{
-    return regex_match(line, storeRegDir);
-}
+/*
+######################################################################
 
-bool isInstructionStoreRegInd(string line)
-{
-    return regex_match(line, storeRegInd);
-}
+    MNEMONIC DISPATCH TABLE
 
-bool isInstructionStoreRegIndDisp(string line)
-{
-    return regex_match(line, storeRegIndDisp);
+######################################################################
+*/
+typedef enum OperandShape
+{
+    NO_OPERANDS,
+    SYMBOL_LIST,
+    SECTION_NAME,
+    SYMBOL_OR_LITERAL_LIST,
+    SKIP_LITERAL,
+    SYMBOL_OR_LITERAL,
+    BRANCH_OPERANDS,
+    ONE_GPR,
+    TWO_GPR,
+    CSR_GPR,
+    GPR_CSR,
+    LOAD_OPERANDS,
+    STORE_OPERANDS
+} OperandShape;
+
+typedef struct Mnemonic
+{
+    LineType type;
+    OperandShape shape;
+} Mnemonic;
+
+// Built once on first use and never destroyed, so parallel assembler
+// threads can keep reading it while another one exits on an error
+static const unordered_map<string, Mnemonic>& mnemonicTable()
+{
+    static const unordered_map<string, Mnemonic>& table = *new unordered_map<string, Mnemonic>{
+        { ".global",  { DIRECTIVE_GLOBAL,      SYMBOL_LIST } },
+        { ".extern",  { DIRECTIVE_EXTERN,      SYMBOL_LIST } },
+        { ".section", { DIRECTIVE_SECTION,     SECTION_NAME } },
+        { ".word",    { DIRECTIVE_WORD,        SYMBOL_OR_LITERAL_LIST } },
+        { ".skip",    { DIRECTIVE_SKIP,        SKIP_LITERAL } },
+        { ".end",     { DIRECTIVE_END,         NO_OPERANDS } },
+        { ".ltorg",   { DIRECTIVE_LTORG,       NO_OPERANDS } },
+        { "halt",     { INSTRUCTION_HALT,      NO_OPERANDS } },
+        { "int",      { INSTRUCTION_INT,       NO_OPERANDS } },
+        { "iret",     { INSTRUCTION_IRET,      NO_OPERANDS } },
+        { "call",     { INSTRUCTION_CALL,      SYMBOL_OR_LITERAL } },
+        { "ret",      { INSTRUCTION_RET,       NO_OPERANDS } },
+        { "jmp",      { INSTRUCTION_JMP,       SYMBOL_OR_LITERAL } },
+        { "beq",      { INSTRUCTION_BEQ,       BRANCH_OPERANDS } },
+        { "bne",      { INSTRUCTION_BNE,       BRANCH_OPERANDS } },
+        { "bgt",      { INSTRUCTION_BGT,       BRANCH_OPERANDS } },
+        { "push",     { INSTRUCTION_PUSH,      ONE_GPR } },
+        { "pop",      { INSTRUCTION_POP,       ONE_GPR } },
+        { "xchg",     { INSTRUCTION_XCHG,      TWO_GPR } },
+        { "add",      { INSTRUCTION_ADD,       TWO_GPR } },
+        { "sub",      { INSTRUCTION_SUB,       TWO_GPR } },
+        { "mul",      { INSTRUCTION_MUL,       TWO_GPR } },
+        { "div",      { INSTRUCTION_DIV,       TWO_GPR } },
+        { "not",      { INSTRUCTION_NOT,       ONE_GPR } },
+        { "and",      { INSTRUCTION_AND,       TWO_GPR } },
+        { "or",       { INSTRUCTION_OR,        TWO_GPR } },
+        { "xor",      { INSTRUCTION_XOR,       TWO_GPR } },
+        { "shl",      { INSTRUCTION_SHL,       TWO_GPR } },
+        { "shr",      { INSTRUCTION_SHR,       TWO_GPR } },
+        { "csrrd",    { INSTRUCTION_CSRRD,     CSR_GPR } },
+        { "csrwr",    { INSTRUCTION_CSRWR,     GPR_CSR } },
+        { "ld",       { INSTRUCTION_LOAD_IMMED,  LOAD_OPERANDS } },
+        { "st",       { INSTRUCTION_STORE_IMMED, STORE_OPERANDS } }
+    };
+    return table;
 }
 
 /*
 ######################################################################
 
-    ASSEMBLY SYMBOLS, LITERALS, REGISTERS, LABELS
+    LINE FORMATING
 
 ######################################################################
 */
-bool isLabel(string line)
+static bool isBadSkipLiteral(const string& literal)
 {
-    return regex_match(line, label);
-}
-
-bool isSymbol(string line)
-{
-    return regex_match(line, symbol_);
+    size_t i = 0;
+    bool negative = scanText(literal, i, "-");
+    if (scanText(literal, i, "0"))
+    {
+        if (i == literal.length()) return true;
+        if (!scanText(literal, i, "x") || (i == literal.length())) return false;
+        while ((i < literal.length()) && (literal[i] == '0')) i++;
+        return i == literal.length();
+    }
+    return negative && (i < literal.length()) && isDigit(literal[i]) && scanNumberLiteral(literal, i) && (i == literal.length());
 }
 
-bool isHexLiteral(string line)
+void formatLine(string& line)
 {
-    return regex_match(line, hex_);
-}
+    string formated;
+    formated.reserve(line.length() + 4);
+    bool pendingSpace = false;
 
-bool isNumberLiteral(string line)
-{
-    return regex_match(line, number_);
-}
+    for (size_t i = 0; i < line.length(); i++)
+    {
+        char c = line[i];
+        // Remove line comments
+        if (c == '#') break;
+        // Remove whitespace in front, after colon and collapse excess whitespaces
+        if (isWhitespace(c))
+        {
+            if ((formated.length() != 0) && (formated.back() != '\n')) pendingSpace = true;
+            continue;
+        }
+        // Remove whitespace before comma and add single whitespace after it
+        if (c == ',')
+        {
+            formated += ',';
+            pendingSpace = true;
+            continue;
+        }
+        if (pendingSpace) formated += ' ';
+        pendingSpace = false;
+        formated += c;
+        // Add newline after colon
+        if (c == ':') formated += '\n';
+    }
+    // Remove whitespace in back
+    while ((formated.length() != 0) && isWhitespace(formated.back())) formated.pop_back();
 
-string getLabelName(string line)
-{
-    return regex_replace(line, column, "");
+    // Remove skip directives with bad literal
+    if ((formated.compare(0, 6, ".skip ") == 0) && isBadSkipLiteral(formated.substr(6)))
+    {
+        formated = "";
+    }
+    line = formated;
 }
 
-string getFirstRegister(string line)
+void removeTrailingZeros(string& line)
 {
-    line = regex_replace(line, percent, "");
-    return regex_replace(line, notFirstReg, "");
+    int cnt = 0;
+    for(int i = 0; i < line.length(); i++)
+    {
+        if (line[i] != '0') break;
+        cnt++;
+    }
+    line = line.substr(cnt);
 }
 
-string getSecondRegister(string line)
-{
-    line = regex_replace(line, percent, "");
-    return regex_replace(line, notSecondReg, "");
-}
+/*
+######################################################################
 
-string getBranchFirstReg(string line)
-{
-    line = regex_replace(line, percent, "");
-    return regex_replace(line, notBranchFirstReg, "");
-}
+    LINE RECOGNITION
 
-string getBranchSecondReg(string line)
+######################################################################
+*/
+static bool parseOperands(const string& line, size_t& i, OperandShape shape, ParsedLine& parsed)
 {
-    line = regex_replace(line, notBranchSecondRegFront, "");
-    return regex_replace(line, notBranchSecondRegBack, "");
+    int mode = 0;
+    switch (shape)
+    {
+    case NO_OPERANDS:
+        return true;
+    case SYMBOL_LIST:
+        return scanList(line, i, parsed, false);
+    case SYMBOL_OR_LITERAL_LIST:
+        return scanList(line, i, parsed, true);
+    case SECTION_NAME:
+    {
+        size_t begin = i;
+        if (!scanSymbol(line, i)) return false;
+        parsed.operand = line.substr(begin, i - begin);
+        parsed.operandKind = OPERAND_SYMBOL;
+        return true;
+    }
+    case SKIP_LITERAL:
+    {
+        size_t begin = i;
+        if (scanHexLiteral(line, i)) parsed.operandKind = OPERAND_HEX;
+        else if (scanNumberLiteral(line, i)) parsed.operandKind = OPERAND_NUMBER;
+        else return false;
+        parsed.operand = line.substr(begin, i - begin);
+        return true;
+    }
+    case SYMBOL_OR_LITERAL:
+        return scanSymbolOrLiteral(line, i, parsed.operand, parsed.operandKind);
+    case BRANCH_OPERANDS:
+        return scanRegister(line, i, parsed.reg1, true, false) && scanText(line, i, ", ") &&
+               scanRegister(line, i, parsed.reg2, true, false) && scanText(line, i, ", ") &&
+               scanSymbolOrLiteral(line, i, parsed.operand, parsed.operandKind);
+    case ONE_GPR:
+        return scanRegister(line, i, parsed.reg1, true, false);
+    case TWO_GPR:
+        return scanRegister(line, i, parsed.reg1, true, false) && scanText(line, i, ", ") &&
+               scanRegister(line, i, parsed.reg2, true, false);
+    case CSR_GPR:
+        return scanRegister(line, i, parsed.reg1, false, true) && scanText(line, i, ", ") &&
+               scanRegister(line, i, parsed.reg2, true, false);
+    case GPR_CSR:
+        return scanRegister(line, i, parsed.reg1, true, false) && scanText(line, i, ", ") &&
+               scanRegister(line, i, parsed.reg2, false, true);
+    case LOAD_OPERANDS:
+        if (!scanMemoryOperand(line, i, parsed, parsed.reg1, mode)) return false;
+        parsed.type = (LineType)(INSTRUCTION_LOAD_IMMED + mode);
+        return scanText(line, i, ", ") && scanRegister(line, i, parsed.reg2, true, false);
+    case STORE_OPERANDS:
+        if (!scanRegister(line, i, parsed.reg1, true, false) || !scanText(line, i, ", ")) return false;
+        if (!scanMemoryOperand(line, i, parsed, parsed.reg2, mode)) return false;
+        parsed.type = (LineType)(INSTRUCTION_STORE_IMMED + mode);
+        return true;
+    }
+    return false;
 }
 
-string getBranchOperand(string line)
+bool parseLine(const string& line, ParsedLine& parsed)
 {
-    return regex_replace(line, notBranchOperand, "");
-}
+    parsed = ParsedLine();
 
-string getLoadOperand(string line)
-{
-    return regex_replace(line, notLoadOperand, "");
-}
+    size_t end = line.find(' ');
+    string mnemonic = line.substr(0, end);
 
-string getLoadRegister(string line)
-{
-    return regex_replace(line, notLoadRegister, "");
-}
+    const unordered_map<string, Mnemonic>& table = mnemonicTable();
+    unordered_map<string, Mnemonic>::const_iterator it = table.find(mnemonic);
+    if (it != table.end())
+    {
+        size_t i = mnemonic.length();
+        bool hasOperands = (it->second.shape != NO_OPERANDS);
+        if (hasOperands && !scanText(line, i, " ")) return false;
 
-string getStoreRegister(string line)
-{
-    line = regex_replace(line, percent, "");
-    return regex_replace(line, notStoreRegister, "");
-}
+        parsed.type = it->second.type;
+        if (parseOperands(line, i, it->second.shape, parsed) && (i == line.length())) return true;
 
-string getStoreOperand(string line)
-{
-    return regex_replace(line, notStoreOperand, "");
-}
+        parsed = ParsedLine();
+        return false;
+    }
 
-string getIndDispRegister(string line)
-{
-    line = regex_replace(line, percent, "");
-    line = regex_replace(line, lbrack, "");
-    return regex_replace(line, notIndDispRegister, "");
+    // Label
+    size_t i = 0;
+    if (scanSymbol(line, i) && (i + 1 == line.length()) && (line[i] == ':'))
+    {
+        parsed.type = LINE_LABEL;
+        parsed.operand = line.substr(0, i);
+        parsed.operandKind = OPERAND_SYMBOL;
+        return true;
+    }
+    return false;
 }
-
-string getIndDispSymOrLit(string line)
-{
-    line = regex_replace(line, rbrack, "");
-    return regex_replace(line, notIndDispSymOrLit, "");
-}
\ No newline at end of file
@@ -0,0 +1,77 @@
+# Times the assembler on one large generated source and the linker on
+# many generated objects that reference each other's globals. The inputs
+# are generated the same way on every run, into a temporary directory.
+# Build first with: make assembler linker. To compare with another build,
+# point BIN at the directory that holds its assembler and linker.
+#
+#	[BIN=dir] bash benchmark.sh [source lines] [object files] [relocations per object]
+
+root=${BIN:-$(cd "$(dirname "$0")/.." && pwd)}
+lines=${1:-200000}
+objects=${2:-1000}
+relocations=${3:-100}
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+cd "$work"
+TIMEFORMAT=%R
+
+# Blocks of 30 instructions end in a jmp, so literal pools always have a
+# place in range. x is a fixed-seed Park-Miller generator.
+awk -v lines="$lines" 'BEGIN {
+	x = 1
+	print ".global main"
+	print ".section code"
+	print "main:"
+	for (block = 0; 32 * block < lines; block++)
+	{
+		print "l" block ":"
+		for (i = 0; i < 30; i++)
+		{
+			x = (x * 16807) % 2147483647
+			pick = x % 10
+			if (pick == 0) print "    st %r1, [%r2 + 4]   # comment"
+			if (pick == 1) print "    add %r1, %r2"
+			if (pick == 2) print "    ld $5, %r3"
+			if (pick == 3) print "    ld $0x12345678, %r1   # comment"
+			if (pick == 4) print "    ld [%sp + 0x08], %r2"
+			if (pick == 5) print "    csrrd %cause, %r1"
+			if (pick == 6) print "    shl %r1, %r2   # comment"
+			if (pick == 7) print "    push %r1"
+			if (pick == 8) print "    ld $l" int(x / 10) % (block + 1) ", %r4"
+			if (pick == 9) print "    beq %r1, %r2, l" int(x / 10) % (block + 1)
+		}
+		print "    jmp l" (block + 1)
+	}
+	print "l" block ":"
+	print "    halt"
+	print ".end"
+}' > big.s
+
+count=$(wc -l < big.s)
+seconds=$( { time "$root/assembler" -o big.o big.s > /dev/null; } 2>&1 )
+echo "assembler: $count lines in $seconds s, $(awk -v n="$count" -v s="$seconds" 'BEGIN { printf "%d", n / s }') lines/s"
+
+# Object i defines g<i> and loads the address of relocations other globals
+step=$(( (objects - 1) / relocations ))
+[ "$step" -ge 1 ] || step=1
+for (( i = 0; i < objects; i++ ))
+do
+	awk -v i="$i" -v objects="$objects" -v relocations="$relocations" -v step="$step" 'BEGIN {
+		externs = ""
+		for (k = 1; k <= relocations; k++) externs = externs (k > 1 ? ", " : "") "g" (i + k * step) % objects
+		print ".global g" i
+		print ".extern " externs
+		print ".section code"
+		print "g" i ":"
+		for (k = 1; k <= relocations; k++) print "  ld $g" (i + k * step) % objects ", %r1"
+		print "  ret"
+		print ".end"
+	}' > "f$i.s"
+done
+for (( i = 0; i < objects; i++ ))
+do
+	"$root/assembler" -o "f$i.o" "f$i.s" > /dev/null || exit 1
+done
+
+seconds=$( { time "$root/linker" -hex -place=code@0x40000000 -o linked.hex f*.o > /dev/null; } 2>&1 )
+echo "linker: $objects objects, $((objects * relocations)) relocations in $seconds s"
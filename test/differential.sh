@@ -0,0 +1,33 @@
+# Runs every test program on the interpreter and on the JIT, which here
+# compiles each block on its first run, and compares what the emulator
+# prints. Build first with: make assembler linker emulator
+
+cd "$(dirname "$0")"
+status=0
+for dir in */
+do
+	dir=${dir%/}
+	[ -f "$dir/start.sh" ] || continue
+	hexFile=$(grep -o -e '-o [^ ]*\.hex' "$dir/start.sh" | cut -d ' ' -f 2)
+
+	rm -f "$dir/$hexFile"
+	(cd "$dir" && bash start.sh > /dev/null 2>&1)
+	if [ ! -f "$dir/$hexFile" ]
+	then
+		echo "FAIL $dir: $hexFile was not built"
+		status=1
+		continue
+	fi
+	interpreted=$(cd "$dir" && ./emulator "$hexFile")
+	compiled=$(cd "$dir" && ./emulator --jit=1 "$hexFile")
+
+	if [ "$interpreted" == "$compiled" ]
+	then
+		echo "PASS $dir"
+	else
+		echo "FAIL $dir"
+		diff <(echo "$interpreted") <(echo "$compiled")
+		status=1
+	fi
+done
+exit $status
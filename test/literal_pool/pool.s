@@ -0,0 +1,22 @@
+# file: pool.s
+# The pool for the loads may not go inside table, it has to be placed
+# right after the halt. r5 is the size of table and must stay 0x7FC.
+
+.section text
+main:
+  ld $0x12345678, %r1
+  ld table, %r2
+  ld second, %r3
+  ld third, %r4
+  ld $second, %r5
+  ld $table, %r6
+  sub %r6, %r5
+  halt
+table:
+  .word 1
+  .skip 2040
+second:
+  .word 2
+third:
+  .word 3
+.end
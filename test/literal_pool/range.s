@@ -0,0 +1,10 @@
+# file: range.s
+# No jmp, ret, halt or .ltorg within reach of the load, the assembler
+# has to refuse instead of putting the pool into the skipped bytes.
+
+.section text
+main:
+  ld $0x12345678, %r1
+  .skip 2100
+  halt
+.end
@@ -0,0 +1,4 @@
+./assembler -o pool.o pool.s
+./linker -hex -place=text@0x40000000 -o pool.hex pool.o
+./emulator pool.hex
+./assembler -o range.o range.s
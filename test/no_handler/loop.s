@@ -0,0 +1,13 @@
+# file: loop.s
+# Counts down long past the first timer tick without ever setting a
+# handler. The tick has to stay pending, the loop must end with r1 = 0.
+
+.section text
+main:
+  ld $0x2000000, %r1
+  ld $1, %r2
+loop:
+  sub %r2, %r1
+  bne %r1, %r0, loop
+  halt
+.end
@@ -0,0 +1,4 @@
+./assembler -o loop.o loop.s
+./linker -hex -place=text@0x40000000 -o loop.hex loop.o
+./emulator loop.hex
+./emulator --jit loop.hex
@@ -0,0 +1,22 @@
+# Runs every test directory that has an expected.txt and compares what
+# start.sh prints, errors included, with it.
+# Build first with: make assembler linker emulator
+
+cd "$(dirname "$0")"
+status=0
+for dir in */
+do
+	dir=${dir%/}
+	[ -f "$dir/expected.txt" ] || continue
+
+	output=$(cd "$dir" && bash start.sh 2>&1)
+	if [ "$output" == "$(cat "$dir/expected.txt")" ]
+	then
+		echo "PASS $dir"
+	else
+		echo "FAIL $dir"
+		diff "$dir/expected.txt" <(echo "$output")
+		status=1
+	fi
+done
+exit $status